@@ -1,4 +1,6 @@
 #include <cstdint>
+#include <cstring>
+#include <cctype>
 #include <exception>
 #include <string>
 #include <memory>
@@ -6,8 +8,10 @@
 #include <limits>
 #include <unordered_map>
 #include <mutex>
+#include <future>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include "Asm6502.h"
 
 using namespace std;
@@ -15,9 +19,60 @@ using namespace std;
 Asm6502::Asm6502(std::shared_ptr<IOLayer> io)
     : CurrentAddress(0)
     , m_io(io)
+    , m_object(dynamic_pointer_cast<ObjectModule>(io))
 {
 }
 
+Asm6502::Asm6502(std::shared_ptr<AsyncIOLayer> io)
+    : CurrentAddress(0)
+    , m_async(io)
+    , m_runStart(0)
+    , m_image(1 << 16)
+    , m_requested(256)
+    , m_loaded(256)
+{
+}
+
+Asm6502::~Asm6502()
+{
+    if (m_async)
+        SendRun();
+}
+
+void Asm6502::SendRun()
+{
+    if (m_run.empty())
+        return;
+    m_writes.push_back(m_async->LoadAsync(move(m_run), m_runStart));
+    m_run.clear();
+}
+
+void Asm6502::WaitForWrites()
+{
+    if (!m_async)
+        return;
+    SendRun();
+
+    vector<future<void>> writes;
+    writes.swap(m_writes);
+
+    exception_ptr failure;
+    for (auto& write : writes)
+    {
+        try
+        {
+            write.get();
+        }
+        catch (...)
+        {
+            if (!failure)
+                failure = current_exception();
+        }
+    }
+    if (failure)
+        rethrow_exception(failure);
+}
+
 void Asm6502::EmitAddr(uint16_t addr)
 {
 #ifdef HOST_BIG_ENDIAN
@@ -31,7 +86,16 @@ void Asm6502::EmitAddr(uint16_t addr)
 
 void Asm6502::EmitByte(uint8_t byte)
 {
-    m_io->Output(byte, CurrentAddress);
+    if (m_async)
+    {
+        if (!m_run.empty() && CurrentAddress != m_runStart + m_run.size())
+            SendRun();
+        if (m_run.empty())
+            m_runStart = CurrentAddress;
+        m_run.push_back(byte);
+    }
+    else
+        m_io->Output(byte, CurrentAddress);
     CurrentAddress++;
 }
 
@@ -93,10 +157,10 @@ void Asm6502::Emit(InstrAbsY i, uint16_t address)
     EmitAddr(address);
 }
 
-void Asm6502::Emit(InstrInd i, uint8_t address)
+void Asm6502::Emit(InstrInd i, uint16_t address)
 {
     EmitByte(static_cast<uint8_t>(i));
-    EmitByte(address);
+    EmitAddr(address);
 }
 
 void Asm6502::Emit(InstrIndX i, uint8_t address)
@@ -111,6 +175,97 @@ void Asm6502::Emit(InstrIndY i, uint8_t address)
     EmitByte(address);
 }
 
+void Asm6502::Label(const string& name)
+{
+    if (!m_object)
+        throw new exception("labels require an ObjectModule");
+    m_object->DefineSymbol(name, CurrentAddress);
+}
+
+string Asm6502::LocalLabel()
+{
+    if (!m_object)
+        throw new exception("labels require an ObjectModule");
+
+    const auto& symbols = m_object->Symbols();
+    for (size_t n = symbols.size(); ; n++)
+    {
+        string name = ".L" + to_string(n);
+        auto used = find_if(symbols.begin(), symbols.end(),
+            [&](const ObjectModule::Symbol& sym) { return sym.Name == name; });
+        if (used == symbols.end())
+        {
+            m_object->DefineSymbol(name, CurrentAddress);
+            return name;
+        }
+    }
+}
+
+void Asm6502::EmitReloc(ObjectModule::RelocKind kind, const string& symbol, int16_t addend)
+{
+    if (!m_object)
+        throw new exception("symbolic operands require an ObjectModule");
+    m_object->AddRelocation(CurrentAddress, kind, symbol, addend);
+    if (kind == ObjectModule::RelocKind::Abs)
+        EmitAddr(0);
+    else
+        EmitByte(0);
+}
+
+void Asm6502::Emit(InstrRel i, const string& symbol)
+{
+    EmitByte(static_cast<uint8_t>(i));
+    EmitReloc(ObjectModule::RelocKind::Rel, symbol, 0);
+}
+
+void Asm6502::Emit(InstrZP i, const string& symbol, int16_t addend)
+{
+    EmitByte(static_cast<uint8_t>(i));
+    EmitReloc(ObjectModule::RelocKind::ZP, symbol, addend);
+}
+
+void Asm6502::Emit(InstrZPX i, const string& symbol, int16_t addend)
+{
+    EmitByte(static_cast<uint8_t>(i));
+    EmitReloc(ObjectModule::RelocKind::ZP, symbol, addend);
+}
+
+void Asm6502::Emit(InstrZPY i, const string& symbol, int16_t addend)
+{
+    EmitByte(static_cast<uint8_t>(i));
+    EmitReloc(ObjectModule::RelocKind::ZP, symbol, addend);
+}
+
+void Asm6502::Emit(InstrAbs i, const string& symbol, int16_t addend)
+{
+    EmitByte(static_cast<uint8_t>(i));
+    EmitReloc(ObjectModule::RelocKind::Abs, symbol, addend);
+}
+
+void Asm6502::Emit(InstrAbsX i, const string& symbol, int16_t addend)
+{
+    EmitByte(static_cast<uint8_t>(i));
+    EmitReloc(ObjectModule::RelocKind::Abs, symbol, addend);
+}
+
+void Asm6502::Emit(InstrAbsY i, const string& symbol, int16_t addend)
+{
+    EmitByte(static_cast<uint8_t>(i));
+    EmitReloc(ObjectModule::RelocKind::Abs, symbol, addend);
+}
+
+void Asm6502::Emit(InstrIndX i, const string& symbol, int16_t addend)
+{
+    EmitByte(static_cast<uint8_t>(i));
+    EmitReloc(ObjectModule::RelocKind::ZP, symbol, addend);
+}
+
+void Asm6502::Emit(InstrIndY i, const string& symbol, int16_t addend)
+{
+    EmitByte(static_cast<uint8_t>(i));
+    EmitReloc(ObjectModule::RelocKind::ZP, symbol, addend);
+}
+
 #define xxx static_cast<uint8_t>(Asm6502::Instruction::INVALID)
 const uint8_t Opcodes[] = {
     //          Implied Immed   A       Rel     ZP      ZPX     ZPY     Abs     AbsX    AbsY    Ind     IndX    IndY
@@ -207,57 +362,231 @@ void BuildOpcodeMap()
     }
 }
 
-vector<Asm6502::Disassembly> Asm6502::Disassemble(uint16_t start, uint16_t end)
+pair<Asm6502::Instruction, Asm6502::Mode> Asm6502::Decode(uint8_t opcode)
 {
     call_once(g_opcodeMapInitialized, BuildOpcodeMap);
+    return g_opcodeMap[opcode];
+}
+
+uint8_t Asm6502::Opcode(Instruction instr, Mode mode)
+{
+    if (instr >= Instruction::MAX_VALUE || mode >= Mode::MAX_VALUE)
+        return static_cast<uint8_t>(Instruction::INVALID);
+    return Opcodes[static_cast<size_t>(instr) * static_cast<size_t>(Mode::MAX_VALUE) + static_cast<size_t>(mode)];
+}
+
+Asm6502::Instruction Asm6502::ParseMnemonic(const string& mnemonic)
+{
+    if (mnemonic.size() != 3)
+        return Instruction::INVALID;
+
+    char upper[3];
+    for (size_t i = 0; i < 3; i++)
+        upper[i] = static_cast<char>(toupper(static_cast<unsigned char>(mnemonic[i])));
+
+    for (size_t i = 0; i < _countof(g_instructionStrings); i++)
+    {
+        if (memcmp(g_instructionStrings[i], upper, 3) == 0)
+            return static_cast<Instruction>(i);
+    }
+    return Instruction::INVALID;
+}
+
+Asm6502::Disassembly Asm6502::DecodeAt(uint16_t address)
+{
+    call_once(g_opcodeMapInitialized, BuildOpcodeMap);
+
+    Disassembly disasem = {};
+    disasem.Address = address;
+    uint8_t byte = Peek(address);
+    const pair<Instruction, Mode>& pair = g_opcodeMap[byte];
+    if (pair.first != Instruction::INVALID)
+    {
+        disasem.Instruction = pair.first;
+        disasem.Mode = pair.second;
+
+        switch (disasem.Mode)
+        {
+        case Mode::Immed:
+        case Mode::Rel:
+        case Mode::ZP:
+        case Mode::ZPX:
+        case Mode::ZPY:
+        case Mode::IndX:
+        case Mode::IndY:
+            disasem.Arg.u8 = Peek(address + 1);
+            break;
+
+        case Mode::Abs:
+        case Mode::AbsX:
+        case Mode::AbsY:
+        case Mode::Ind:
+            disasem.Arg.u16 = Peek(address + 1) | (Peek(address + 2) << 8);
+            break;
+
+        case Mode::Implied:
+        case Mode::A:
+            break;
+        }
+    }
+    else
+    {
+        disasem.Instruction = Instruction::INVALID;
+        disasem.Mode = Mode::Implied;
+        disasem.Arg.u8 = byte;
+    }
+    return disasem;
+}
+
+uint8_t Asm6502::Peek(uint16_t address)
+{
+    return m_async ? m_image[address] : m_io->Input(address);
+}
+
+void Asm6502::ResetPages()
+{
+    // Memory may have changed since the last disassembly, so nothing already read is reused.
+    m_requested.assign(256, false);
+    m_loaded.assign(256, false);
+}
+
+bool Asm6502::FetchPages(uint16_t address, uint32_t length)
+{
+    bool loaded = true;
+    uint32_t first = address >> 8;
+    uint32_t last = (address + length - 1) >> 8;
+    for (uint32_t p = first; p <= last && p < first + 256; p++)
+    {
+        uint8_t page = static_cast<uint8_t>(p);
+        if (!m_requested[page])
+        {
+            m_requested[page] = true;
+            m_reads.push_back(make_pair(page, m_async->ReadAsync(static_cast<uint16_t>(page << 8), 256)));
+        }
+        loaded = loaded && m_loaded[page];
+    }
+    return loaded;
+}
+
+void Asm6502::CompleteReads()
+{
+    vector<pair<uint8_t, future<vector<uint8_t>>>> reads;
+    reads.swap(m_reads);
+    for (auto& read : reads)
+    {
+        vector<uint8_t> data = read.second.get();
+        copy(data.begin(), data.end(), m_image.begin() + (read.first << 8));
+        m_loaded[read.first] = true;
+    }
+}
+
+uint8_t Asm6502::Length(Mode mode)
+{
+    switch (mode)
+    {
+    case Mode::Implied:
+    case Mode::A:
+        return 1;
+    case Mode::Abs:
+    case Mode::AbsX:
+    case Mode::AbsY:
+    case Mode::Ind:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+vector<Asm6502::Disassembly> Asm6502::Disassemble(uint16_t start, uint16_t end)
+{
     vector<Disassembly> retval;
 
-    for (uint16_t i = start; i <= end; i++)
+    if (m_async)
     {
-        Disassembly disasem = {};
-        disasem.Address = i;
-        uint8_t byte = m_io->Input(i);
-        const pair<Instruction, Mode>& pair = g_opcodeMap[byte];
-        if (pair.first != Instruction::INVALID)
+        // Request the whole range (plus the operand of the last instruction) at once.
+        SendRun();
+        ResetPages();
+        FetchPages(start, end - start + 3);
+        CompleteReads();
+    }
+
+    for (uint32_t i = start; i <= end; )
+    {
+        Disassembly disasem = DecodeAt(static_cast<uint16_t>(i));
+        retval.push_back(disasem);
+        i += Length(disasem.Mode);
+    }
+
+    return retval;
+}
+
+vector<Asm6502::Disassembly> Asm6502::DisassembleReachable(const vector<uint16_t>& entries)
+{
+    vector<Disassembly> retval;
+    vector<bool> visited(1 << 16);
+    vector<uint16_t> pending(entries.rbegin(), entries.rend());
+
+    // With an async layer, flow that reaches a page not yet read waits in `blocked` while the walk
+    // carries on elsewhere, so reads of every page it runs into are in flight together.
+    vector<uint16_t> blocked;
+    if (m_async)
+    {
+        SendRun();
+        ResetPages();
+    }
+
+    while (!pending.empty() || !blocked.empty())
+    {
+        if (pending.empty())
         {
-            disasem.Instruction = pair.first;
-            disasem.Mode = pair.second;
+            CompleteReads();
+            pending.swap(blocked);
+        }
+        uint32_t address = pending.back();
+        pending.pop_back();
 
-            switch (disasem.Mode)
+        // Follow straight-line flow until it ends, queueing up any other targets along the way.
+        while (address <= 0xffff && !visited[address])
+        {
+            if (m_async && !FetchPages(static_cast<uint16_t>(address), 3))
             {
-            case Mode::Immed:
-            case Mode::Rel:
-            case Mode::ZP:
-            case Mode::ZPX:
-            case Mode::ZPY:
-            case Mode::Ind:
-            case Mode::IndX:
-            case Mode::IndY:
-                i++;
-                disasem.Arg.u8 = m_io->Input(i);
+                blocked.push_back(static_cast<uint16_t>(address));
                 break;
-
-            case Mode::Abs:
-            case Mode::AbsX:
-            case Mode::AbsY:
-                disasem.Arg.u16 = m_io->Input(i + 1) | (m_io->Input(i + 2) << 8);
-                i += 2;
+            }
+            Disassembly disasem = DecodeAt(static_cast<uint16_t>(address));
+            if (disasem.Instruction == Instruction::INVALID)
                 break;
+            visited[address] = true;
+            retval.push_back(disasem);
 
-            case Mode::Implied:
-            case Mode::A:
+            uint32_t next = address + Length(disasem.Mode);
+            if (disasem.Mode == Mode::Rel)
+            {
+                pending.push_back(static_cast<uint16_t>(next + static_cast<int8_t>(disasem.Arg.u8)));
+            }
+            else if (disasem.Instruction == Instruction::JSR)
+            {
+                pending.push_back(disasem.Arg.u16);
+            }
+            else if (disasem.Instruction == Instruction::JMP)
+            {
+                // Indirect jump targets aren't known until run time.
+                if (disasem.Mode == Mode::Abs)
+                    pending.push_back(disasem.Arg.u16);
                 break;
             }
+            else if (disasem.Instruction == Instruction::RTS
+                || disasem.Instruction == Instruction::RTI
+                || disasem.Instruction == Instruction::BRK)
+            {
+                break;
+            }
+            address = next;
         }
-        else
-        {
-            disasem.Instruction = Instruction::INVALID;
-            disasem.Mode = Mode::Implied;
-            disasem.Arg.u8 = byte;
-        }
-        retval.push_back(disasem);
     }
 
+    sort(retval.begin(), retval.end(),
+        [](const Disassembly& a, const Disassembly& b) { return a.Address < b.Address; });
     return retval;
 }
 
@@ -286,7 +615,6 @@ void Asm6502::PrintDisassembly(const vector<Disassembly>& disassembly)
             case Mode::Immed:
                 cout << "#";
                 // fall through
-            case Mode::Ind: // identical to ZP, only used for JMP
             case Mode::ZP:
             case Mode::ZPX:
             case Mode::ZPY:
@@ -307,6 +635,9 @@ void Asm6502::PrintDisassembly(const vector<Disassembly>& disassembly)
                     cout << ",Y";
                 break;
 
+            case Mode::Ind:
+                cout << "($" << setw(4) << instr.Arg.u16 << ")";
+                break;
             case Mode::IndX:
                 cout << "($" << setw(2) << +instr.Arg.u8 << ",X)";
                 break;
@@ -317,4 +648,107 @@ void Asm6502::PrintDisassembly(const vector<Disassembly>& disassembly)
             cout << endl;
         }
     }
+}
+
+bool Asm6502::IsReadModifyWrite(Instruction instr)
+{
+    switch (instr)
+    {
+    case Instruction::ASL:
+    case Instruction::DEC:
+    case Instruction::INC:
+    case Instruction::LSR:
+    case Instruction::ROL:
+    case Instruction::ROR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint8_t Asm6502::Cycles(uint8_t opcode)
+{
+    call_once(g_opcodeMapInitialized, BuildOpcodeMap);
+    const pair<Instruction, Mode>& pair = g_opcodeMap[opcode];
+    Instruction instr = pair.first;
+    bool rmw = IsReadModifyWrite(instr);
+
+    switch (pair.second)
+    {
+    case Mode::Implied:
+        switch (instr)
+        {
+        case Instruction::INVALID:
+            return 0;
+        case Instruction::BRK:
+            return 7;
+        case Instruction::PHA:
+        case Instruction::PHP:
+            return 3;
+        case Instruction::PLA:
+        case Instruction::PLP:
+            return 4;
+        case Instruction::RTI:
+        case Instruction::RTS:
+            return 6;
+        default:
+            return 2;
+        }
+
+    case Mode::Immed:
+    case Mode::A:
+    case Mode::Rel:
+        return 2;
+
+    case Mode::ZP:
+        return rmw ? 5 : 3;
+
+    case Mode::ZPX:
+    case Mode::ZPY:
+        return rmw ? 6 : 4;
+
+    case Mode::Abs:
+        if (instr == Instruction::JMP)
+            return 3;
+        if (instr == Instruction::JSR)
+            return 6;
+        return rmw ? 6 : 4;
+
+    case Mode::AbsX:
+    case Mode::AbsY:
+        if (rmw)
+            return 7;
+        return (instr == Instruction::STA) ? 5 : 4;
+
+    case Mode::Ind:
+        return 5;
+
+    case Mode::IndX:
+        return 6;
+
+    case Mode::IndY:
+        return (instr == Instruction::STA) ? 6 : 5;
+    }
+
+    return 0;
+}
+
+bool Asm6502::PageCrossPenalty(uint8_t opcode)
+{
+    call_once(g_opcodeMapInitialized, BuildOpcodeMap);
+    const pair<Instruction, Mode>& pair = g_opcodeMap[opcode];
+    if (pair.first == Instruction::INVALID)
+        return false;
+
+    switch (pair.second)
+    {
+    case Mode::Rel:
+        return true;
+    case Mode::AbsX:
+    case Mode::AbsY:
+    case Mode::IndY:
+        return !IsReadModifyWrite(pair.first) && pair.first != Instruction::STA;
+    default:
+        return false;
+    }
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "IOLayer.h"
+#include "ObjectModule.h"
+#include "AsyncIOLayer.h"
 
 class Asm6502
 {
@@ -57,7 +59,7 @@ public:
         ASL = 0x0a, // Arithmetic Shift Left
         LSR = 0x4a, // Logical Shift Right by One
         ROL = 0x2a, // Rotate Left by One
-        ROR = 0x2a, // Rotate Right by One
+        ROR = 0x6a, // Rotate Right by One
     };
 
     // Relative
@@ -189,7 +191,7 @@ public:
         STA = 0x99, // Store A
     };
 
-    // Indirect from Pointer in the Zero Page
+    // Indirect through a 16-bit Pointer
     enum class InstrInd : uint8_t
     {
         JMP = 0x6c, // Branch Unconditionally
@@ -297,7 +299,7 @@ public:
         Abs,        // Absolute
         AbsX,       // Absolute Indexed by 'X' Register
         AbsY,       // Absolute Indexed by 'Y' Register
-        Ind,        // Indirect from Pointer in the Zero Page
+        Ind,        // Indirect through a 16-bit Pointer (JMP only)
         IndX,       // Indirect from Pointer in the Zero Page Indexed by 'X' Register Before Dereferencing
         IndY,       // Indirect from Pointer in the Zero Page Indexed by 'Y' Register After Dereferencing
         MAX_VALUE
@@ -305,6 +307,19 @@ public:
 
     Asm6502(std::shared_ptr<IOLayer> io);
 
+    // Emits and disassembles without waiting on each access: emitted bytes are collected into
+    // runs of consecutive addresses, each sent with one LoadAsync and not waited for (see
+    // WaitForWrites), and disassembly reads every page it needs with many requests in flight.
+    // Call WaitForWrites() before destroying the Asm6502 to find out whether the writes worked.
+    Asm6502(std::shared_ptr<AsyncIOLayer> io);
+
+    // Sends any emitted bytes still being collected, but doesn't wait for them: a failure to write
+    // them goes unreported.
+    ~Asm6502();
+
+    // Waits for every write queued so far to complete, and rethrows the first failure.
+    void WaitForWrites();
+
     void Emit(InstrImplied);
     void Emit(InstrImmed, uint8_t value);
     void Emit(InstrA);
@@ -315,10 +330,31 @@ public:
     void Emit(InstrAbs, uint16_t address);
     void Emit(InstrAbsX, uint16_t address);
     void Emit(InstrAbsY, uint16_t address);
-    void Emit(InstrInd, uint8_t ptrAddress);
+    void Emit(InstrInd, uint16_t ptrAddress);
     void Emit(InstrIndX, uint8_t ptrAddress);
     void Emit(InstrIndY, uint8_t ptrAddress);
 
+    // Symbolic operands, resolved by the Linker. These are only available when the IOLayer is an
+    // ObjectModule; the operand bytes are emitted as zero and a relocation is recorded for them.
+    void Label(const std::string& name);
+
+    // Whether the IOLayer is an ObjectModule, i.e. CurrentAddress is an offset into a section and
+    // not the final address.
+    bool Relocatable() const { return m_object != nullptr; }
+
+    // Defines a module-local label (see ObjectModule::DefineSymbol) at CurrentAddress, with a name
+    // not yet used in the module, and returns the name.
+    std::string LocalLabel();
+    void Emit(InstrRel, const std::string& symbol);
+    void Emit(InstrZP, const std::string& symbol, int16_t addend = 0);
+    void Emit(InstrZPX, const std::string& symbol, int16_t addend = 0);
+    void Emit(InstrZPY, const std::string& symbol, int16_t addend = 0);
+    void Emit(InstrAbs, const std::string& symbol, int16_t addend = 0);
+    void Emit(InstrAbsX, const std::string& symbol, int16_t addend = 0);
+    void Emit(InstrAbsY, const std::string& symbol, int16_t addend = 0);
+    void Emit(InstrIndX, const std::string& symbol, int16_t addend = 0);
+    void Emit(InstrIndY, const std::string& symbol, int16_t addend = 0);
+
     void EmitBytes(const uint8_t* bytes, size_t nBytes);
     void EmitByte(uint8_t byte);
     void EmitAddr(uint16_t addr);
@@ -338,10 +374,57 @@ public:
     std::vector<Disassembly> Disassemble(
         uint16_t start = 0,
         uint16_t end = std::numeric_limits<uint16_t>::max());
+
+    // Disassembles only code reachable from the given entry points, following branches, jumps and
+    // subroutine calls rather than sweeping linearly, so that data is never decoded as code.
+    // The result is sorted by address.
+    std::vector<Disassembly> DisassembleReachable(const std::vector<uint16_t>& entries);
     static void PrintDisassembly(const std::vector<Disassembly>& disassembly);
 
+    // Instruction and addressing mode of an opcode (Instruction::INVALID for unused opcodes).
+    static std::pair<Instruction, Mode> Decode(uint8_t opcode);
+
+    // Opcode for an instruction in the given mode, or Instruction::INVALID if there is none.
+    static uint8_t Opcode(Instruction instr, Mode mode);
+
+    // Instruction for a mnemonic like "STA" (case-insensitive), or Instruction::INVALID.
+    static Instruction ParseMnemonic(const std::string& mnemonic);
+
+    // Base cycle count of an opcode (0 for invalid opcodes).
+    static uint8_t Cycles(uint8_t opcode);
+
+    // Whether the opcode takes an extra cycle when its indexed address crosses a page boundary.
+    // Branches also report true here: they take one extra cycle when taken, and one more when the
+    // target is on a different page from the next instruction.
+    static bool PageCrossPenalty(uint8_t opcode);
+
+    // Size in bytes of an instruction in the given addressing mode, including the opcode.
+    static uint8_t Length(Mode mode);
+
+    // Whether the instruction reads, modifies and writes back its operand (INC, ASL, etc.)
+    static bool IsReadModifyWrite(Instruction instr);
+
     uint16_t CurrentAddress;
 
 private:
+    Disassembly DecodeAt(uint16_t address);
+    void SendRun();
+    uint8_t Peek(uint16_t address);
+
+    // Async reads for disassembly: memory is fetched a page at a time into m_image.
+    void ResetPages();
+    bool FetchPages(uint16_t address, uint32_t length);
+    void CompleteReads();
+    void EmitReloc(ObjectModule::RelocKind kind, const std::string& symbol, int16_t addend);
+
     std::shared_ptr<IOLayer> m_io;
+    std::shared_ptr<ObjectModule> m_object;
+    std::shared_ptr<AsyncIOLayer> m_async;
+    std::vector<uint8_t> m_run;
+    uint16_t m_runStart;
+    std::vector<std::future<void>> m_writes;
+    std::vector<uint8_t> m_image;
+    std::vector<bool> m_requested;
+    std::vector<bool> m_loaded;
+    std::vector<std::pair<uint8_t, std::future<std::vector<uint8_t>>>> m_reads;
 };
\ No newline at end of file
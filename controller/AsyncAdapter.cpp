@@ -0,0 +1,185 @@
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <vector>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "AsyncAdapter.h"
+
+using namespace std;
+
+AsyncAdapter::AsyncAdapter(shared_ptr<IOLayer> io)
+    : m_io(io)
+    , m_stopping(false)
+{
+    m_worker = thread(&AsyncAdapter::Run, this);
+}
+
+AsyncAdapter::~AsyncAdapter()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_worker.join();
+}
+
+future<void> AsyncAdapter::LoadAsync(vector<uint8_t> bytes, uint16_t address)
+{
+    unique_ptr<WriteRequest> request(new WriteRequest());
+    request->Kind = RequestKind::Load;
+    request->Address = address;
+    request->Bytes = move(bytes);
+    future<void> result = request->Done.get_future();
+    Enqueue(move(request));
+    return result;
+}
+
+future<void> AsyncAdapter::OutputAsync(uint8_t value, uint16_t address)
+{
+    unique_ptr<WriteRequest> request(new WriteRequest());
+    request->Kind = RequestKind::Output;
+    request->Address = address;
+    request->Bytes.push_back(value);
+    future<void> result = request->Done.get_future();
+    Enqueue(move(request));
+    return result;
+}
+
+future<uint8_t> AsyncAdapter::InputAsync(uint16_t address)
+{
+    unique_ptr<InputRequest> request(new InputRequest());
+    request->Kind = RequestKind::Input;
+    request->Address = address;
+    future<uint8_t> result = request->Value.get_future();
+    Enqueue(move(request));
+    return result;
+}
+
+future<vector<uint8_t>> AsyncAdapter::ReadAsync(uint16_t address, uint32_t length)
+{
+    unique_ptr<ReadRequest> request(new ReadRequest());
+    request->Kind = RequestKind::Read;
+    request->Address = address;
+    request->Length = length;
+    future<vector<uint8_t>> result = request->Data.get_future();
+    Enqueue(move(request));
+    return result;
+}
+
+void AsyncAdapter::Enqueue(unique_ptr<Request> request)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_queue.push_back(move(request));
+    }
+    m_wake.notify_one();
+}
+
+void AsyncAdapter::Run()
+{
+    vector<unique_ptr<Request>> batch;
+    unique_lock<mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty())
+            return;
+
+        batch.swap(m_queue);
+        lock.unlock();
+        Execute(batch);
+        batch.clear();
+        lock.lock();
+    }
+}
+
+void AsyncAdapter::Execute(vector<unique_ptr<Request>>& batch)
+{
+    for (size_t i = 0, n = batch.size(); i < n; )
+    {
+        switch (batch[i]->Kind)
+        {
+        case RequestKind::Output:
+        {
+            // Gather the run of writes to consecutive addresses that starts here.
+            auto& request = static_cast<WriteRequest&>(*batch[i]);
+            size_t end = i + 1;
+            while (end < n
+                && batch[end]->Kind == RequestKind::Output
+                && batch[end]->Address == request.Address + (end - i))
+            {
+                request.Bytes.push_back(static_cast<WriteRequest&>(*batch[end]).Bytes[0]);
+                end++;
+            }
+
+            try
+            {
+                if (end - i == 1)
+                    m_io->Output(request.Bytes[0], request.Address);
+                else
+                    m_io->Load(request.Bytes, request.Address);
+                for (size_t j = i; j < end; j++)
+                    static_cast<WriteRequest&>(*batch[j]).Done.set_value();
+            }
+            catch (...)
+            {
+                for (size_t j = i; j < end; j++)
+                    static_cast<WriteRequest&>(*batch[j]).Done.set_exception(current_exception());
+            }
+            i = end;
+            continue;
+        }
+
+        case RequestKind::Load:
+        {
+            auto& request = static_cast<WriteRequest&>(*batch[i]);
+            try
+            {
+                m_io->Load(move(request.Bytes), request.Address);
+                request.Done.set_value();
+            }
+            catch (...)
+            {
+                request.Done.set_exception(current_exception());
+            }
+            break;
+        }
+
+        case RequestKind::Input:
+        {
+            auto& request = static_cast<InputRequest&>(*batch[i]);
+            try
+            {
+                request.Value.set_value(m_io->Input(request.Address));
+            }
+            catch (...)
+            {
+                request.Value.set_exception(current_exception());
+            }
+            break;
+        }
+
+        case RequestKind::Read:
+        {
+            auto& request = static_cast<ReadRequest&>(*batch[i]);
+            try
+            {
+                vector<uint8_t> data(request.Length);
+                for (uint32_t j = 0; j < request.Length; j++)
+                    data[j] = m_io->Input(static_cast<uint16_t>(request.Address + j));
+                request.Data.set_value(move(data));
+            }
+            catch (...)
+            {
+                request.Data.set_exception(current_exception());
+            }
+            break;
+        }
+        }
+        i++;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "IOLayer.h"
+#include "AsyncIOLayer.h"
+
+// Runs a synchronous IOLayer behind the AsyncIOLayer interface.
+//
+// Requests are queued and carried out in order on a worker thread. Whatever has queued up while
+// the worker was busy is taken as one batch, and within a batch, writes to consecutive addresses
+// are sent to the IOLayer as a single Load() (Asm6502 already sends its writes in runs, so this
+// only helps callers that write a byte at a time).
+class AsyncAdapter : public AsyncIOLayer
+{
+public:
+    AsyncAdapter(std::shared_ptr<IOLayer> io);
+
+    // Finishes every queued request before returning.
+    virtual ~AsyncAdapter();
+
+    virtual std::future<void> LoadAsync(std::vector<uint8_t> bytes, uint16_t address = 0);
+    virtual std::future<void> OutputAsync(uint8_t value, uint16_t address);
+    virtual std::future<uint8_t> InputAsync(uint16_t address);
+    virtual std::future<std::vector<uint8_t>> ReadAsync(uint16_t address, uint32_t length);
+
+private:
+    AsyncAdapter(const AsyncAdapter&) = delete;
+    AsyncAdapter& operator=(const AsyncAdapter&) = delete;
+
+    enum class RequestKind
+    {
+        Load,
+        Output,
+        Input,
+        Read,
+    };
+
+    // Each kind of request carries only the promise it completes.
+    struct Request
+    {
+        virtual ~Request() {}
+
+        RequestKind Kind;
+        uint16_t Address;
+    };
+
+    struct WriteRequest : Request          // Load and Output
+    {
+        std::vector<uint8_t> Bytes;
+        std::promise<void> Done;
+    };
+
+    struct InputRequest : Request
+    {
+        std::promise<uint8_t> Value;
+    };
+
+    struct ReadRequest : Request
+    {
+        uint32_t Length;
+        std::promise<std::vector<uint8_t>> Data;
+    };
+
+    void Enqueue(std::unique_ptr<Request> request);
+    void Run();
+    void Execute(std::vector<std::unique_ptr<Request>>& batch);
+
+    std::shared_ptr<IOLayer> m_io;
+    std::vector<std::unique_ptr<Request>> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping;
+    std::thread m_worker;
+};
\ No newline at end of file
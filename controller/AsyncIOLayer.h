@@ -0,0 +1,21 @@
+#pragma once
+
+#include <future>
+#include <vector>
+
+// The asynchronous counterpart of IOLayer, for targets where every access is a round trip (a
+// remote machine, a device on a serial link, ...). Requests return immediately with a future, so
+// many can be in flight at once, and the layer is free to batch queued requests together.
+// Requests to one layer complete in the order they were made, so a read sees every earlier write.
+class AsyncIOLayer
+{
+public:
+    virtual ~AsyncIOLayer() {}
+
+    virtual std::future<void> LoadAsync(std::vector<uint8_t> bytes, uint16_t address = 0) = 0;
+    virtual std::future<void> OutputAsync(uint8_t value, uint16_t address) = 0;
+    virtual std::future<uint8_t> InputAsync(uint16_t address) = 0;
+
+    // Reads `length` bytes starting at `address` as a single request.
+    virtual std::future<std::vector<uint8_t>> ReadAsync(uint16_t address, uint32_t length) = 0;
+};
\ No newline at end of file
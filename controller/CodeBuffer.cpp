@@ -0,0 +1,192 @@
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+#include "CodeBuffer.h"
+
+using namespace std;
+
+static const size_t NoSection = static_cast<size_t>(-1);
+
+CodeBuffer::CodeBuffer()
+    : m_arena(1 << 16)
+    , m_active(NoSection)
+    , m_activeLimit(0)
+{
+}
+
+uint16_t CodeBuffer::AddSection(const string& name, uint16_t origin, uint32_t limit)
+{
+    if (limit > (1 << 16) || limit <= origin)
+        throw new exception("section limit must be above its origin and at most 65536");
+    if (FindSection(name) != NoSection)
+        throw new exception("section already exists");
+    for (const auto& s : m_sections)
+    {
+        if (origin >= s.Origin && origin < s.Origin + s.Size)
+            throw new exception("section origin overlaps an existing section");
+        if (origin == s.Origin)
+            throw new exception("section origin is already in use");
+    }
+
+    Section s = { name, origin, limit, 0, false };
+    m_sections.push_back(s);
+    m_active = m_sections.size() - 1;
+    UpdateActiveLimit();
+    return origin;
+}
+
+uint16_t CodeBuffer::SetSection(const string& name)
+{
+    size_t i = FindSection(name);
+    if (i == NoSection)
+        throw new exception("no such section");
+    m_active = i;
+    UpdateActiveLimit();
+    return m_sections[i].Cursor();
+}
+
+const CodeBuffer::Section& CodeBuffer::GetSection(const string& name) const
+{
+    size_t i = FindSection(name);
+    if (i == NoSection)
+        throw new exception("no such section");
+    return m_sections[i];
+}
+
+CodeBuffer::Mark CodeBuffer::GetMark() const
+{
+    Mark mark;
+    mark.Sizes.reserve(m_sections.size());
+    for (const auto& s : m_sections)
+        mark.Sizes.push_back(s.Size);
+    mark.JournalLength = m_journal.size();
+    return mark;
+}
+
+void CodeBuffer::Rollback(const Mark& mark)
+{
+    if (mark.JournalLength > m_journal.size() || mark.Sizes.size() > m_sections.size())
+        throw new exception("mark does not belong to this buffer's history");
+
+    // Undo overwrites newest-first, then drop anything appended since the mark. Bytes past the end
+    // of a section are kept zeroed so that Input() of unused memory stays predictable.
+    while (m_journal.size() > mark.JournalLength)
+    {
+        const JournalEntry& entry = m_journal.back();
+        m_arena[entry.Address] = entry.OldValue;
+        size_t i = FindSection(entry.Address);
+        if (i != NoSection)
+            m_sections[i].Dirty = true;
+        m_journal.pop_back();
+    }
+
+    for (size_t i = 0, n = m_sections.size(); i < n; i++)
+    {
+        Section& s = m_sections[i];
+        uint32_t size = (i < mark.Sizes.size()) ? mark.Sizes[i] : 0;
+        if (s.Size > size)
+        {
+            memset(m_arena.data() + s.Origin + size, 0, s.Size - size);
+            s.Size = size;
+            s.Dirty = true;
+        }
+    }
+}
+
+void CodeBuffer::Flush(IOLayer& target)
+{
+    for (auto& s : m_sections)
+    {
+        if (s.Dirty && s.Size > 0)
+        {
+            const uint8_t* begin = m_arena.data() + s.Origin;
+            target.Load(vector<uint8_t>(begin, begin + s.Size), s.Origin);
+        }
+        s.Dirty = false;
+    }
+}
+
+void CodeBuffer::Load(vector<uint8_t> bytes, uint16_t address)
+{
+    for (size_t i = 0, n = bytes.size(); i < n; i++)
+    {
+        Output(bytes[i], static_cast<uint16_t>(address + i));
+    }
+}
+
+void CodeBuffer::Output(uint8_t value, uint16_t address)
+{
+    if (m_active != NoSection)
+    {
+        Section& s = m_sections[m_active];
+        if (address >= s.Origin && address <= s.Origin + s.Size)
+        {
+            if (address == s.Origin + s.Size)
+            {
+                if (address >= m_activeLimit)
+                    throw new exception("section is full");
+                s.Size++;
+            }
+            else
+            {
+                JournalEntry entry = { address, m_arena[address] };
+                m_journal.push_back(entry);
+            }
+            m_arena[address] = value;
+            s.Dirty = true;
+            return;
+        }
+    }
+
+    // Not the active section: only patching of bytes already emitted elsewhere is allowed.
+    size_t i = FindSection(address);
+    if (i == NoSection)
+        throw new exception("address is not inside any section");
+
+    JournalEntry entry = { address, m_arena[address] };
+    m_journal.push_back(entry);
+    m_arena[address] = value;
+    m_sections[i].Dirty = true;
+}
+
+uint8_t CodeBuffer::Input(uint16_t address)
+{
+    return m_arena[address];
+}
+
+size_t CodeBuffer::FindSection(const string& name) const
+{
+    for (size_t i = 0, n = m_sections.size(); i < n; i++)
+    {
+        if (m_sections[i].Name == name)
+            return i;
+    }
+    return NoSection;
+}
+
+size_t CodeBuffer::FindSection(uint16_t address) const
+{
+    for (size_t i = 0, n = m_sections.size(); i < n; i++)
+    {
+        const Section& s = m_sections[i];
+        if (address >= s.Origin && address < s.Origin + s.Size)
+            return i;
+    }
+    return NoSection;
+}
+
+void CodeBuffer::UpdateActiveLimit()
+{
+    // The active section may grow up to its own limit or the origin of the next section above it,
+    // whichever comes first.
+    const Section& active = m_sections[m_active];
+    m_activeLimit = active.Limit;
+    for (size_t i = 0, n = m_sections.size(); i < n; i++)
+    {
+        const Section& s = m_sections[i];
+        if (i != m_active && s.Origin > active.Origin && s.Origin < m_activeLimit)
+            m_activeLimit = s.Origin;
+    }
+}
\ No newline at end of file
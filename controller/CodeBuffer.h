@@ -0,0 +1,72 @@
+#pragma once
+
+#include "IOLayer.h"
+
+// An in-memory emit target for Asm6502.
+//
+// Code is assembled into a 64K arena split into named sections (e.g. "code", "data", "zp"), each
+// with its own origin and limit. Nothing reaches the real IOLayer until Flush(), which sends each
+// dirty section to it in a single Load() call. Appending to a section is free to undo: take a Mark
+// before emitting and Rollback to it to discard everything written since.
+class CodeBuffer : public IOLayer
+{
+public:
+    struct Section
+    {
+        std::string Name;
+        uint16_t Origin;
+        uint32_t Limit;     // one past the last usable address
+        uint32_t Size;
+        bool Dirty;
+
+        uint16_t Cursor() const { return static_cast<uint16_t>(Origin + Size); }
+    };
+
+    struct Mark
+    {
+        std::vector<uint32_t> Sizes;
+        size_t JournalLength;
+    };
+
+    CodeBuffer();
+
+    // Adds a section and makes it the active one. Returns the address to start emitting at.
+    uint16_t AddSection(const std::string& name, uint16_t origin, uint32_t limit = 1 << 16);
+
+    // Makes an existing section the active one. Returns the address to continue emitting at.
+    uint16_t SetSection(const std::string& name);
+
+    const Section& GetSection(const std::string& name) const;
+    const std::vector<Section>& Sections() const { return m_sections; }
+
+    // Marks stay valid across Flush(), so the journal of overwritten bytes is kept for the
+    // buffer's lifetime (appends aren't journaled, so it only grows with patches). Sections changed
+    // by a Rollback become dirty again, but bytes it drops from the end of a section that was
+    // already flushed are not cleared on the target.
+    Mark GetMark() const;
+    void Rollback(const Mark& mark);
+
+    // Writes every dirty section to the target in one Load() each, then marks them clean.
+    void Flush(IOLayer& target);
+
+    virtual void Load(std::vector<uint8_t> bytes, uint16_t address = 0);
+    virtual void Output(uint8_t value, uint16_t address);
+    virtual uint8_t Input(uint16_t address);
+
+private:
+    struct JournalEntry
+    {
+        uint16_t Address;
+        uint8_t OldValue;
+    };
+
+    size_t FindSection(const std::string& name) const;
+    size_t FindSection(uint16_t address) const;
+    void UpdateActiveLimit();
+
+    std::vector<uint8_t> m_arena;
+    std::vector<Section> m_sections;
+    std::vector<JournalEntry> m_journal;
+    size_t m_active;
+    uint32_t m_activeLimit;
+};
\ No newline at end of file
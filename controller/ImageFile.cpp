@@ -0,0 +1,349 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cwctype>
+#include <exception>
+#include <string>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include "MappedFile.h"
+#include "VIC20.h"
+#include "ImageFile.h"
+
+using namespace std;
+
+// Bytes per Intel HEX data record. 16 is what every programmer accepts.
+static const uint32_t HexRecordSize = 16;
+
+static const char g_hexChars[] = "0123456789ABCDEF";
+
+static void CheckRange(const ImageFile::Range& range)
+{
+    if (range.Length == 0 || range.Address + range.Length > (1 << 16))
+        throw new exception("image range is empty or runs past $FFFF");
+}
+
+static int HexDigit(uint8_t c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+static uint8_t HexByte(const uint8_t* p)
+{
+    int high = HexDigit(p[0]);
+    int low = HexDigit(p[1]);
+    if (high < 0 || low < 0)
+        throw new exception("bad hex digit in Intel HEX record");
+    return static_cast<uint8_t>((high << 4) | low);
+}
+
+static char* PutHex(char* p, uint8_t value)
+{
+    *p++ = g_hexChars[value >> 4];
+    *p++ = g_hexChars[value & 0xf];
+    return p;
+}
+
+static wstring Extension(const wstring& path)
+{
+    size_t dot = path.rfind(L'.');
+    wstring extension = (dot == wstring::npos) ? wstring() : path.substr(dot + 1);
+    for (auto& c : extension)
+        c = static_cast<wchar_t>(towlower(c));
+    return extension;
+}
+
+// Streams memory from the source in fixed-size chunks.
+static void WriteBytes(ostream& out, IOLayer& source, uint16_t address, uint32_t length)
+{
+    char chunk[256];
+    for (uint32_t offset = 0; offset < length; )
+    {
+        uint32_t n = min<uint32_t>(sizeof(chunk), length - offset);
+        for (uint32_t i = 0; i < n; i++)
+            chunk[i] = static_cast<char>(source.Input(static_cast<uint16_t>(address + offset + i)));
+        out.write(chunk, n);
+        offset += n;
+    }
+}
+
+vector<ImageFile::Range> ImageFile::ReadPrg(const uint8_t* data, size_t size, IOLayer& target)
+{
+    if (size < 2)
+        throw new exception(".prg file is missing its load address");
+
+    Range range = { static_cast<uint16_t>(data[0] | (data[1] << 8)), static_cast<uint32_t>(size - 2) };
+    vector<Range> ranges;
+    if (range.Length == 0)
+        return ranges;
+    CheckRange(range);
+
+    target.Load(vector<uint8_t>(data + 2, data + size), range.Address);
+    ranges.push_back(range);
+    return ranges;
+}
+
+vector<ImageFile::Range> ImageFile::ReadHex(const uint8_t* data, size_t size, IOLayer& target)
+{
+    vector<Range> ranges;
+    vector<uint8_t> run;
+    run.reserve(1 << 16);
+    uint16_t runStart = 0;
+
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    bool done = false;
+    while (p < end && !done)
+    {
+        uint8_t c = *p++;
+        if (c == '\r' || c == '\n' || c == ' ' || c == '\t')
+            continue;
+        if (c != ':')
+            throw new exception("Intel HEX record doesn't start with ':'");
+
+        // :ccaaaatt, then cc data bytes and a checksum, all as hex digit pairs
+        if (end - p < 10)
+            throw new exception("Intel HEX record is truncated");
+        uint8_t count = HexByte(p);
+        uint8_t addressHigh = HexByte(p + 2);
+        uint8_t addressLow = HexByte(p + 4);
+        uint8_t type = HexByte(p + 6);
+        p += 8;
+        if (end - p < 2 * count + 2)
+            throw new exception("Intel HEX record is truncated");
+
+        uint32_t address = (addressHigh << 8) | addressLow;
+        uint8_t sum = count + addressHigh + addressLow + type;
+        if (type == 0)
+        {
+            if (address + count > (1 << 16))
+                throw new exception("Intel HEX record runs past $FFFF");
+
+            // Data that doesn't carry on from the last record starts a new run.
+            if (!run.empty() && address != runStart + run.size())
+            {
+                Range range = { runStart, static_cast<uint32_t>(run.size()) };
+                ranges.push_back(range);
+                target.Load(run, runStart);
+                run.clear();
+            }
+            if (run.empty())
+                runStart = static_cast<uint16_t>(address);
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint8_t value = HexByte(p + 2 * i);
+                sum += value;
+                run.push_back(value);
+            }
+        }
+        else
+        {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint8_t byte = HexByte(p + 2 * i);
+                sum += byte;
+                value = (value << 8) | byte;
+            }
+
+            switch (type)
+            {
+            case 1:     // end of file
+                done = true;
+                break;
+            case 2:     // extended segment address
+            case 4:     // extended linear address
+                if (value != 0)
+                    throw new exception("Intel HEX file has data above $FFFF");
+                break;
+            case 3:     // start segment address
+            case 5:     // start linear address
+                break;
+            default:
+                throw new exception("unknown Intel HEX record type");
+            }
+        }
+        p += 2 * count;
+
+        sum += HexByte(p);
+        p += 2;
+        if (sum != 0)
+            throw new exception("Intel HEX record checksum mismatch");
+    }
+
+    if (!run.empty())
+    {
+        Range range = { runStart, static_cast<uint32_t>(run.size()) };
+        ranges.push_back(range);
+        target.Load(move(run), runStart);
+    }
+    return ranges;
+}
+
+vector<ImageFile::Range> ImageFile::ReadCartridge(const uint8_t* data, size_t size, uint16_t block, IOLayer& target)
+{
+    if (block % BLK_Size != 0)
+        throw new exception("cartridge block must start on an 8K boundary");
+
+    vector<Range> ranges;
+    if (size == 0)
+        return ranges;
+    if (block + size > (1 << 16))
+        throw new exception("cartridge image runs past $FFFF");
+
+    target.Load(vector<uint8_t>(data, data + size), block);
+    Range range = { block, static_cast<uint32_t>(size) };
+    ranges.push_back(range);
+    return ranges;
+}
+
+vector<ImageFile::Range> ImageFile::Read(const wstring& path, IOLayer& target, uint16_t block)
+{
+    wstring extension = Extension(path);
+    MappedFile file(path);
+    if (extension == L"prg")
+        return ReadPrg(file.Data(), file.Size(), target);
+    if (extension == L"hex")
+        return ReadHex(file.Data(), file.Size(), target);
+    if (extension == L"bin")
+        return ReadCartridge(file.Data(), file.Size(), block, target);
+    throw new exception("unknown image file extension; expected .prg, .hex or .bin");
+}
+
+void ImageFile::WritePrg(ostream& out, IOLayer& source, Range range)
+{
+    CheckRange(range);
+
+    char header[2] = { static_cast<char>(range.Address & 0xff), static_cast<char>(range.Address >> 8) };
+    out.write(header, sizeof(header));
+    WriteBytes(out, source, range.Address, range.Length);
+}
+
+void ImageFile::WriteHex(ostream& out, IOLayer& source, const vector<Range>& ranges)
+{
+    char line[1 + 2 * (4 + HexRecordSize + 1) + 1];
+    for (const auto& range : ranges)
+    {
+        CheckRange(range);
+        for (uint32_t offset = 0; offset < range.Length; offset += HexRecordSize)
+        {
+            uint16_t address = static_cast<uint16_t>(range.Address + offset);
+            uint8_t count = static_cast<uint8_t>(min(HexRecordSize, range.Length - offset));
+            uint8_t sum = count + (address >> 8) + (address & 0xff);
+
+            char* p = line;
+            *p++ = ':';
+            p = PutHex(p, count);
+            p = PutHex(p, static_cast<uint8_t>(address >> 8));
+            p = PutHex(p, static_cast<uint8_t>(address & 0xff));
+            p = PutHex(p, 0);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint8_t value = source.Input(static_cast<uint16_t>(address + i));
+                sum += value;
+                p = PutHex(p, value);
+            }
+            p = PutHex(p, static_cast<uint8_t>(-sum));
+            *p++ = '\n';
+            out.write(line, p - line);
+        }
+    }
+    out.write(":00000001FF\n", 12);
+}
+
+// End of the cartridge image for `block`. Every range must lie inside the block, since a raw
+// binary has nowhere to put anything else.
+static uint32_t CartridgeEnd(uint16_t block, const vector<ImageFile::Range>& ranges)
+{
+    if (block % BLK_Size != 0)
+        throw new exception("cartridge block must start on an 8K boundary");
+
+    uint32_t blockEnd = block + BLK_Size;
+    uint32_t end = block;
+    for (const auto& range : ranges)
+    {
+        CheckRange(range);
+        uint32_t rangeEnd = range.Address + range.Length;
+        if (range.Address < block || rangeEnd > blockEnd)
+            throw new exception("image has data outside the cartridge block, which a raw binary can't hold");
+        end = max(end, rangeEnd);
+    }
+    if (end == block)
+        throw new exception("nothing to write in the cartridge block");
+    return end;
+}
+
+void ImageFile::WriteCartridge(ostream& out, IOLayer& source, uint16_t block, const vector<Range>& ranges)
+{
+    uint32_t end = CartridgeEnd(block, ranges);
+    WriteBytes(out, source, block, end - block);
+}
+
+void ImageFile::Write(const wstring& path, IOLayer& source, const vector<Range>& ranges, uint16_t block)
+{
+    wstring extension = Extension(path);
+    if (extension != L"prg" && extension != L"hex" && extension != L"bin")
+        throw new exception("unknown image file extension; expected .prg, .hex or .bin");
+    if (ranges.empty())
+        throw new exception("nothing to write");
+    if (extension == L"bin")
+        CartridgeEnd(block, ranges);    // check before creating the file
+
+#ifdef _WIN32
+    ofstream out(path, ios::binary);
+#else
+    string narrow(path.size() * MB_CUR_MAX + 1, '\0');
+    narrow.resize(wcstombs(&narrow[0], path.c_str(), narrow.size()));
+    ofstream out(narrow, ios::binary);
+#endif
+    if (!out)
+        throw new exception("unable to create file");
+
+    if (extension == L"prg")
+    {
+        uint32_t start = 1 << 16;
+        uint32_t end = 0;
+        for (const auto& range : ranges)
+        {
+            start = min<uint32_t>(start, range.Address);
+            end = max(end, range.Address + range.Length);
+        }
+        Range all = { static_cast<uint16_t>(start), end - start };
+        WritePrg(out, source, all);
+    }
+    else if (extension == L"hex")
+    {
+        WriteHex(out, source, ranges);
+    }
+    else
+    {
+        WriteCartridge(out, source, block, ranges);
+    }
+
+    out.flush();
+    if (!out)
+        throw new exception("unable to write file");
+}
+
+vector<ImageFile::Range> ImageFile::Ranges(const CodeBuffer& code, bool dirtyOnly)
+{
+    vector<Range> ranges;
+    for (const auto& section : code.Sections())
+    {
+        if (section.Size > 0 && (section.Dirty || !dirtyOnly))
+        {
+            Range range = { section.Origin, section.Size };
+            ranges.push_back(range);
+        }
+    }
+    sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.Address < b.Address; });
+    return ranges;
+}
\ No newline at end of file
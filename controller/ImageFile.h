@@ -0,0 +1,43 @@
+#pragma once
+
+#include "IOLayer.h"
+#include "CodeBuffer.h"
+
+// Reads and writes memory images in the formats other VIC-20 tools exchange: .prg files (a
+// two-byte load address followed by the data), Intel HEX, and raw cartridge binaries holding one
+// BLK from its start address.
+//
+// Readers parse in place, without allocating per line, and send each contiguous run of data to
+// the target in one Load(). Writers stream only the ranges they are given, e.g. the sections of a
+// CodeBuffer.
+class ImageFile
+{
+public:
+    struct Range
+    {
+        uint16_t Address;
+        uint32_t Length;
+    };
+
+    // Each reader returns the ranges it loaded.
+    static std::vector<Range> ReadPrg(const uint8_t* data, size_t size, IOLayer& target);
+    static std::vector<Range> ReadHex(const uint8_t* data, size_t size, IOLayer& target);
+    static std::vector<Range> ReadCartridge(const uint8_t* data, size_t size, uint16_t block, IOLayer& target);
+
+    // Reads a file according to its extension: .prg, .hex, or .bin (a cartridge at `block`).
+    static std::vector<Range> Read(const std::wstring& path, IOLayer& target, uint16_t block);
+
+    // A .prg holds a single range.
+    static void WritePrg(std::ostream& out, IOLayer& source, Range range);
+    static void WriteHex(std::ostream& out, IOLayer& source, const std::vector<Range>& ranges);
+
+    // Writes `block` from its start address up to the end of the last range. Throws if any range
+    // lies outside the block.
+    static void WriteCartridge(std::ostream& out, IOLayer& source, uint16_t block, const std::vector<Range>& ranges);
+
+    // Writes a file according to its extension. A .prg gets one range spanning all of `ranges`.
+    static void Write(const std::wstring& path, IOLayer& source, const std::vector<Range>& ranges, uint16_t block);
+
+    // The non-empty sections of a CodeBuffer, or only those changed since the last Flush().
+    static std::vector<Range> Ranges(const CodeBuffer& code, bool dirtyOnly = false);
+};
\ No newline at end of file
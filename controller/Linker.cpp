@@ -0,0 +1,240 @@
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "VIC20.h"
+#include "Linker.h"
+
+using namespace std;
+
+static bool IsLocal(const string& symbol)
+{
+    return !symbol.empty() && symbol[0] == '.';
+}
+
+Linker::Linker()
+{
+    AddRegion("RAM1", RAM1, RAM2);
+    AddRegion("RAM2", RAM2, RAM3);
+    AddRegion("RAM3", RAM3, 0x1000);
+    AddRegion("BLK1", BLK1, BLK2);
+    AddRegion("BLK2", BLK2, BLK3);
+    AddRegion("BLK3", BLK3, 0x8000);
+    AddRegion("BLK5", BLK5, 0xc000);
+}
+
+void Linker::AddRegion(const string& name, uint16_t start, uint32_t end)
+{
+    if (end > (1 << 16) || end <= start)
+        throw new exception("region end must be above its start and at most 65536");
+    for (const auto& r : m_regions)
+    {
+        if (r.Name == name)
+            throw new exception("region already exists");
+    }
+
+    Region r = { name, start, end };
+    m_regions.push_back(r);
+}
+
+void Linker::Place(const string& section, const string& region)
+{
+    for (size_t i = 0, n = m_regions.size(); i < n; i++)
+    {
+        if (m_regions[i].Name == region)
+        {
+            m_placements[section] = i;
+            return;
+        }
+    }
+    throw new exception("no such region");
+}
+
+void Linker::AddModule(const string& name, shared_ptr<ObjectModule> module)
+{
+    for (auto& state : m_modules)
+    {
+        if (state.Name == name)
+        {
+            state.Module = module;
+            return;
+        }
+    }
+
+    ModuleState state;
+    state.Name = name;
+    state.Module = module;
+    state.Linked = false;
+    state.Dirty = false;
+    state.Hash = 0;
+    m_modules.push_back(state);
+}
+
+void Linker::RemoveModule(const string& name)
+{
+    for (auto it = m_modules.begin(); it != m_modules.end(); ++it)
+    {
+        if (it->Name == name)
+        {
+            m_modules.erase(it);
+            return;
+        }
+    }
+}
+
+size_t Linker::Link()
+{
+    // Lay out every section, in module order, to find where each one lands. This is cheap; the
+    // expensive part (copying and patching) is skipped below for modules that haven't moved.
+    vector<uint32_t> cursors;
+    for (const auto& r : m_regions)
+        cursors.push_back(r.Start);
+
+    vector<vector<uint16_t>> bases(m_modules.size());
+    for (size_t m = 0, n = m_modules.size(); m < n; m++)
+    {
+        const auto& sections = m_modules[m].Module->Sections();
+        bases[m].resize(sections.size());
+        for (size_t i = 0, ns = sections.size(); i < ns; i++)
+        {
+            size_t size = sections[i].Bytes.size();
+            auto placement = m_placements.find(sections[i].Name);
+            if (placement == m_placements.end())
+            {
+                if (size == 0)
+                    continue;
+                throw new exception("section has not been placed in a region");
+            }
+
+            size_t r = placement->second;
+            if (cursors[r] + size > m_regions[r].End)
+                throw new exception("region overflow");
+            bases[m][i] = static_cast<uint16_t>(cursors[r]);
+            cursors[r] += static_cast<uint32_t>(size);
+        }
+    }
+
+    m_symbols.clear();
+    for (size_t m = 0, n = m_modules.size(); m < n; m++)
+    {
+        for (const auto& sym : m_modules[m].Module->Symbols())
+        {
+            if (IsLocal(sym.Name))
+                continue;
+            uint16_t address = static_cast<uint16_t>(bases[m][sym.Section] + sym.Offset);
+            if (!m_symbols.insert(make_pair(sym.Name, address)).second)
+                throw new exception("symbol is defined in more than one module");
+        }
+    }
+
+    size_t relinked = 0;
+    vector<uint16_t> imports;
+    for (size_t m = 0, n = m_modules.size(); m < n; m++)
+    {
+        ModuleState& state = m_modules[m];
+        const auto& references = state.Module->References();
+        imports.resize(references.size());
+        for (size_t i = 0, nr = references.size(); i < nr; i++)
+        {
+            if (IsLocal(references[i]))
+            {
+                const auto& symbols = state.Module->Symbols();
+                auto local = find_if(symbols.begin(), symbols.end(),
+                    [&](const ObjectModule::Symbol& sym) { return sym.Name == references[i]; });
+                if (local == symbols.end())
+                    throw new exception("undefined local symbol");
+                imports[i] = static_cast<uint16_t>(bases[m][local->Section] + local->Offset);
+                continue;
+            }
+
+            auto sym = m_symbols.find(references[i]);
+            if (sym == m_symbols.end())
+                throw new exception("undefined symbol");
+            imports[i] = sym->second;
+        }
+
+        uint64_t hash = state.Module->Hash();
+        if (state.Linked && state.Hash == hash && state.Bases == bases[m] && state.Imports == imports)
+            continue;
+
+        state.Hash = hash;
+        state.Bases.swap(bases[m]);
+        state.Imports.swap(imports);
+        Relocate(state);
+        relinked++;
+    }
+
+    return relinked;
+}
+
+void Linker::Relocate(ModuleState& state)
+{
+    const auto& sections = state.Module->Sections();
+    state.Image.resize(sections.size());
+    for (size_t i = 0, n = sections.size(); i < n; i++)
+        state.Image[i] = sections[i].Bytes;
+
+    for (const auto& reloc : state.Module->Relocations())
+    {
+        vector<uint8_t>& bytes = state.Image[reloc.Section];
+        int32_t value = state.Imports[reloc.Reference] + reloc.Addend;
+        switch (reloc.Kind)
+        {
+        case ObjectModule::RelocKind::Abs:
+            if (reloc.Offset + 1u >= bytes.size())
+                throw new exception("relocation is past the end of its section");
+            bytes[reloc.Offset] = static_cast<uint8_t>(value);
+            bytes[reloc.Offset + 1] = static_cast<uint8_t>(value >> 8);
+            break;
+
+        case ObjectModule::RelocKind::ZP:
+            if (reloc.Offset >= bytes.size())
+                throw new exception("relocation is past the end of its section");
+            if (value < 0 || value > 0xff)
+                throw new exception("zero page relocation target is outside the zero page");
+            bytes[reloc.Offset] = static_cast<uint8_t>(value);
+            break;
+
+        case ObjectModule::RelocKind::Rel:
+        {
+            if (reloc.Offset >= bytes.size())
+                throw new exception("relocation is past the end of its section");
+            int32_t next = state.Bases[reloc.Section] + reloc.Offset + 1;
+            int32_t delta = value - next;
+            if (delta < -128 || delta > 127)
+                throw new exception("branch target is out of range");
+            bytes[reloc.Offset] = static_cast<uint8_t>(delta);
+            break;
+        }
+        }
+    }
+
+    state.Linked = true;
+    state.Dirty = true;
+}
+
+void Linker::Flush(IOLayer& target)
+{
+    for (auto& state : m_modules)
+    {
+        if (!state.Dirty)
+            continue;
+        for (size_t i = 0, n = state.Image.size(); i < n; i++)
+        {
+            if (!state.Image[i].empty())
+                target.Load(state.Image[i], state.Bases[i]);
+        }
+        state.Dirty = false;
+    }
+}
+
+uint16_t Linker::SymbolAddress(const string& name) const
+{
+    auto sym = m_symbols.find(name);
+    if (sym == m_symbols.end())
+        throw new exception("undefined symbol");
+    return sym->second;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "IOLayer.h"
+#include "ObjectModule.h"
+
+// Places ObjectModule sections into memory regions and resolves their relocations.
+//
+// Linking is incremental: each module's hash, section addresses and resolved imports are cached,
+// and a module is only re-patched when one of them changes. Flush() then writes just the modules
+// that were re-patched since the last flush.
+class Linker
+{
+public:
+    struct Region
+    {
+        std::string Name;
+        uint16_t Start;
+        uint32_t End;       // one past the last usable address
+    };
+
+    // Starts out with the VIC-20 expansion regions RAM1-RAM3, BLK1-BLK3 and BLK5.
+    Linker();
+
+    void AddRegion(const std::string& name, uint16_t start, uint32_t end);
+
+    // Sections with the given name, in every module, are laid out in the given region.
+    void Place(const std::string& section, const std::string& region);
+
+    // Adds a module, or replaces the one already registered under the same name.
+    void AddModule(const std::string& name, std::shared_ptr<ObjectModule> module);
+    void RemoveModule(const std::string& name);
+
+    // Lays out and relocates all modules. Returns how many modules had to be re-patched.
+    size_t Link();
+
+    void Flush(IOLayer& target);
+
+    uint16_t SymbolAddress(const std::string& name) const;
+
+private:
+    struct ModuleState
+    {
+        std::string Name;
+        std::shared_ptr<ObjectModule> Module;
+        bool Linked;
+        bool Dirty;
+        uint64_t Hash;
+        std::vector<uint16_t> Bases;    // per section
+        std::vector<uint16_t> Imports;  // per reference
+        std::vector<std::vector<uint8_t>> Image;    // per section, relocated
+    };
+
+    void Relocate(ModuleState& state);
+
+    std::vector<Region> m_regions;
+    std::unordered_map<std::string, size_t> m_placements;
+    std::vector<ModuleState> m_modules;
+    std::unordered_map<std::string, uint16_t> m_symbols;
+};
\ No newline at end of file
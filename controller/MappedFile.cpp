@@ -0,0 +1,108 @@
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "MappedFile.h"
+
+using namespace std;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const wstring& path)
+    : m_file(INVALID_HANDLE_VALUE)
+    , m_mapping(nullptr)
+    , m_data(nullptr)
+    , m_size(0)
+{
+    m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+        throw new exception("unable to open file");
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || static_cast<uint64_t>(size.QuadPart) > SIZE_MAX)
+    {
+        CloseHandle(m_file);
+        throw new exception("unable to get file size");
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+
+    // Empty files can't be mapped; they simply have no data.
+    if (m_size == 0)
+        return;
+
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping != nullptr)
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        if (m_mapping != nullptr)
+            CloseHandle(m_mapping);
+        CloseHandle(m_file);
+        throw new exception("unable to map file");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    CloseHandle(m_file);
+}
+
+#else
+
+MappedFile::MappedFile(const wstring& path)
+    : m_fd(-1)
+    , m_data(nullptr)
+    , m_size(0)
+{
+    string narrow(path.size() * MB_CUR_MAX + 1, '\0');
+    size_t length = wcstombs(&narrow[0], path.c_str(), narrow.size());
+    if (length == static_cast<size_t>(-1))
+        throw new exception("file name can't be converted");
+    narrow.resize(length);
+
+    m_fd = open(narrow.c_str(), O_RDONLY);
+    if (m_fd < 0)
+        throw new exception("unable to open file");
+
+    struct stat st;
+    if (fstat(m_fd, &st) != 0)
+    {
+        close(m_fd);
+        throw new exception("unable to get file size");
+    }
+    m_size = static_cast<size_t>(st.st_size);
+
+    if (m_size == 0)
+        return;
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(m_fd);
+        throw new exception("unable to map file");
+    }
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const uint8_t*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    close(m_fd);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+// A read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    MappedFile(const std::wstring& path);
+    ~MappedFile();
+
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#else
+    int m_fd;
+#endif
+    const uint8_t* m_data;
+    size_t m_size;
+};
\ No newline at end of file
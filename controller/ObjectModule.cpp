@@ -0,0 +1,151 @@
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "ObjectModule.h"
+
+using namespace std;
+
+static const uint64_t FnvOffsetBasis = 0xcbf29ce484222325ull;
+static const uint64_t FnvPrime = 0x100000001b3ull;
+
+static void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FnvPrime;
+    }
+}
+
+static void HashString(uint64_t& hash, const string& s)
+{
+    uint32_t size = static_cast<uint32_t>(s.size());
+    HashBytes(hash, &size, sizeof(size));
+    HashBytes(hash, s.data(), s.size());
+}
+
+ObjectModule::ObjectModule()
+    : m_active(0)
+    , m_hash(0)
+    , m_hashValid(false)
+{
+    SetSection("code");
+}
+
+uint16_t ObjectModule::SetSection(const string& name)
+{
+    for (size_t i = 0, n = m_sections.size(); i < n; i++)
+    {
+        if (m_sections[i].Name == name)
+        {
+            m_active = static_cast<uint16_t>(i);
+            return static_cast<uint16_t>(m_sections[i].Bytes.size());
+        }
+    }
+
+    Section s;
+    s.Name = name;
+    m_sections.push_back(s);
+    m_active = static_cast<uint16_t>(m_sections.size() - 1);
+    m_hashValid = false;
+    return 0;
+}
+
+void ObjectModule::DefineSymbol(const string& name, uint16_t offset)
+{
+    for (const auto& sym : m_symbols)
+    {
+        if (sym.Name == name)
+            throw new exception("symbol is already defined in this module");
+    }
+
+    Symbol sym = { name, m_active, offset };
+    m_symbols.push_back(sym);
+    m_hashValid = false;
+}
+
+void ObjectModule::AddRelocation(uint16_t offset, RelocKind kind, const string& symbol, int16_t addend)
+{
+    size_t ref = 0;
+    for (size_t n = m_references.size(); ref < n; ref++)
+    {
+        if (m_references[ref] == symbol)
+            break;
+    }
+    if (ref == m_references.size())
+        m_references.push_back(symbol);
+
+    Relocation reloc = { m_active, offset, kind, static_cast<uint16_t>(ref), addend };
+    m_relocations.push_back(reloc);
+    m_hashValid = false;
+}
+
+uint64_t ObjectModule::Hash() const
+{
+    if (m_hashValid)
+        return m_hash;
+
+    uint64_t hash = FnvOffsetBasis;
+    for (const auto& s : m_sections)
+    {
+        HashString(hash, s.Name);
+        uint32_t size = static_cast<uint32_t>(s.Bytes.size());
+        HashBytes(hash, &size, sizeof(size));
+        HashBytes(hash, s.Bytes.data(), s.Bytes.size());
+    }
+    for (const auto& sym : m_symbols)
+    {
+        HashString(hash, sym.Name);
+        HashBytes(hash, &sym.Section, sizeof(sym.Section));
+        HashBytes(hash, &sym.Offset, sizeof(sym.Offset));
+    }
+    for (const auto& ref : m_references)
+    {
+        HashString(hash, ref);
+    }
+    for (const auto& reloc : m_relocations)
+    {
+        HashBytes(hash, &reloc.Section, sizeof(reloc.Section));
+        HashBytes(hash, &reloc.Offset, sizeof(reloc.Offset));
+        HashBytes(hash, &reloc.Kind, sizeof(reloc.Kind));
+        HashBytes(hash, &reloc.Reference, sizeof(reloc.Reference));
+        HashBytes(hash, &reloc.Addend, sizeof(reloc.Addend));
+    }
+
+    m_hash = hash;
+    m_hashValid = true;
+    return m_hash;
+}
+
+void ObjectModule::Load(vector<uint8_t> bytes, uint16_t address)
+{
+    vector<uint8_t>& section = m_sections[m_active].Bytes;
+    if (section.size() < address + bytes.size())
+        section.resize(address + bytes.size());
+    copy(bytes.begin(), bytes.end(), section.begin() + address);
+    m_hashValid = false;
+}
+
+void ObjectModule::Output(uint8_t value, uint16_t address)
+{
+    vector<uint8_t>& section = m_sections[m_active].Bytes;
+    if (address == section.size())
+        section.push_back(value);
+    else if (address < section.size())
+        section[address] = value;
+    else
+    {
+        section.resize(address + 1);
+        section[address] = value;
+    }
+    m_hashValid = false;
+}
+
+uint8_t ObjectModule::Input(uint16_t address)
+{
+    const vector<uint8_t>& section = m_sections[m_active].Bytes;
+    return (address < section.size()) ? section[address] : 0;
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "IOLayer.h"
+
+// A relocatable object module: named sections of code/data, the symbols they define, and the
+// relocations that must be patched once the linker has decided where everything lives.
+//
+// As an IOLayer, addresses are offsets into the active section, so an Asm6502 emitting into a
+// module starts each section at CurrentAddress = 0 (or wherever SetSection says to continue).
+class ObjectModule : public IOLayer
+{
+public:
+    enum class RelocKind : uint8_t
+    {
+        Abs,    // 16-bit little-endian address
+        ZP,     // 8-bit address that must land in the zero page
+        Rel,    // 8-bit signed branch offset, relative to the following instruction
+    };
+
+    struct Section
+    {
+        std::string Name;
+        std::vector<uint8_t> Bytes;
+    };
+
+    struct Symbol
+    {
+        std::string Name;
+        uint16_t Section;
+        uint16_t Offset;
+    };
+
+    struct Relocation
+    {
+        uint16_t Section;
+        uint16_t Offset;        // of the operand byte(s), not the opcode
+        RelocKind Kind;
+        uint16_t Reference;     // index into References()
+        int16_t Addend;
+    };
+
+    ObjectModule();
+
+    // Makes the named section active, creating it if needed. Returns the offset to continue at.
+    uint16_t SetSection(const std::string& name);
+
+    // Symbols whose names start with '.' are local: the linker resolves references to them only
+    // against this module's own symbols, so every module can use the same local names.
+    void DefineSymbol(const std::string& name, uint16_t offset);
+    void AddRelocation(uint16_t offset, RelocKind kind, const std::string& symbol, int16_t addend);
+
+    const std::vector<Section>& Sections() const { return m_sections; }
+    const std::vector<Symbol>& Symbols() const { return m_symbols; }
+    const std::vector<std::string>& References() const { return m_references; }
+    const std::vector<Relocation>& Relocations() const { return m_relocations; }
+
+    // FNV-1a hash of the module's entire contents; cached until the module is next modified.
+    uint64_t Hash() const;
+
+    virtual void Load(std::vector<uint8_t> bytes, uint16_t address = 0);
+    virtual void Output(uint8_t value, uint16_t address);
+    virtual uint8_t Input(uint16_t address);
+
+private:
+    std::vector<Section> m_sections;
+    std::vector<Symbol> m_symbols;
+    std::vector<std::string> m_references;
+    std::vector<Relocation> m_relocations;
+    uint16_t m_active;
+    mutable uint64_t m_hash;
+    mutable bool m_hashValid;
+};
\ No newline at end of file
@@ -0,0 +1,562 @@
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include "CodeBuffer.h"
+#include "Routines.h"
+#include "VIC20.h"
+
+using namespace std;
+
+using Implied = Asm6502::InstrImplied;
+using Immed = Asm6502::InstrImmed;
+using A = Asm6502::InstrA;
+using Rel = Asm6502::InstrRel;
+using ZP = Asm6502::InstrZP;
+using Abs = Asm6502::InstrAbs;
+using AbsX = Asm6502::InstrAbsX;
+
+template<typename T>
+static uint32_t Cyc(T instr)
+{
+    return Asm6502::Cycles(static_cast<uint8_t>(instr));
+}
+
+// Cycles taken by a branch that is taken, given the address of the instruction after it.
+static uint32_t TakenCycles(uint16_t next, uint16_t target)
+{
+    return Cyc(Rel::BNE) + 1 + (((next ^ target) & 0xff00) ? 1 : 0);
+}
+
+// Emits the zero page form of an instruction if the address allows, else the absolute form.
+template<typename TZP, typename TAbs>
+static uint32_t EmitZPOrAbs(Asm6502& cpu, TZP zp, TAbs abs, uint16_t address)
+{
+    if (address < 0x100)
+    {
+        cpu.Emit(zp, static_cast<uint8_t>(address));
+        return Cyc(zp);
+    }
+    cpu.Emit(abs, address);
+    return Cyc(abs);
+}
+
+// Countdown loops run X from `iterations` down to 1, so an X-indexed access to the bytes at
+// `start` uses start - 1 as its operand. A 256-iteration loop starts at X = 0 instead.
+static uint16_t IndexBase(uint16_t start, uint32_t iterations)
+{
+    return (iterations == 256) ? start : static_cast<uint16_t>(start - 1);
+}
+
+// Number of page-crossing penalties an X-indexed read at `base` takes over a whole countdown loop.
+static uint32_t IndexCrossings(uint16_t base, uint32_t iterations)
+{
+    uint32_t first = (iterations == 256) ? 0 : 1;
+    uint32_t last = (iterations == 256) ? 255 : iterations;
+    uint32_t crossing = max<uint32_t>(first, 0x100 - (base & 0xff));
+    return (last >= crossing) ? last - crossing + 1 : 0;
+}
+
+Routines::Routines(Asm6502& cpu)
+    : m_cpu(cpu)
+{
+}
+
+uint16_t Routines::BeginCountdown(uint32_t iterations)
+{
+    if (iterations == 0 || iterations > 256)
+        throw new exception("a loop must run between 1 and 256 times");
+    m_cpu.Emit(Immed::LDX, static_cast<uint8_t>(iterations));
+    return m_cpu.CurrentAddress;
+}
+
+uint32_t Routines::EndCountdown(uint16_t top, uint32_t iterations)
+{
+    m_cpu.Emit(Implied::DEX);
+    EmitBranch(Rel::BNE, top);
+    return Cyc(Immed::LDX)
+        + iterations * Cyc(Implied::DEX)
+        + (iterations - 1) * TakenCycles(m_cpu.CurrentAddress, top)
+        + Cyc(Rel::BNE);
+}
+
+void Routines::EmitBranch(Rel instr, uint16_t target)
+{
+    int32_t offset = target - (m_cpu.CurrentAddress + 2);
+    if (offset < -128 || offset > 127)
+        throw new exception("branch target is out of range");
+    m_cpu.Emit(instr, static_cast<uint8_t>(offset));
+}
+
+void Routines::PatchBranch(Rel instr, uint16_t at)
+{
+    uint16_t here = m_cpu.CurrentAddress;
+    m_cpu.CurrentAddress = at;
+    EmitBranch(instr, here);
+    m_cpu.CurrentAddress = here;
+}
+
+uint16_t Routines::BeginSelfReferences(std::string& label)
+{
+    // In an ObjectModule, CurrentAddress is only an offset; the real address comes from the linker.
+    if (m_cpu.Relocatable())
+        label = m_cpu.LocalLabel();
+    return m_cpu.CurrentAddress;
+}
+
+void Routines::EmitSelfReference(Abs instr, uint16_t base, const string& label, uint16_t offset)
+{
+    if (label.empty())
+        m_cpu.Emit(instr, static_cast<uint16_t>(base + offset));
+    else
+        m_cpu.Emit(instr, label, static_cast<int16_t>(offset));
+}
+
+void Routines::PatchSelfReference(Abs instr, uint16_t at, uint16_t base, const string& label, uint16_t offset)
+{
+    uint16_t here = m_cpu.CurrentAddress;
+    m_cpu.CurrentAddress = at;
+    EmitSelfReference(instr, base, label, offset);
+    m_cpu.CurrentAddress = here;
+}
+
+Routines::Cost Routines::Fill(uint16_t dst, uint16_t count, uint8_t value, const Variant& variant)
+{
+    uint16_t start = m_cpu.CurrentAddress;
+    uint32_t cycles = 0;
+
+    if (variant.Form == Form::SelfModifying)
+    {
+        uint32_t pages = count / 256;
+        uint32_t rest = count % 256;
+        if (pages == 0)
+            throw new exception("the self-modifying form needs at least one full page");
+
+        // Reset the operand the loop increments, so the routine can be run more than once.
+        m_cpu.Emit(Immed::LDA, static_cast<uint8_t>(dst >> 8));
+        uint16_t reset = m_cpu.CurrentAddress;
+        m_cpu.Emit(Abs::STA, static_cast<uint16_t>(0));
+        m_cpu.Emit(Immed::LDA, value);
+        m_cpu.Emit(Immed::LDY, static_cast<uint8_t>(pages));
+        m_cpu.Emit(Immed::LDX, static_cast<uint8_t>(0));
+        cycles += 2 * Cyc(Immed::LDA) + Cyc(Abs::STA) + Cyc(Immed::LDY) + Cyc(Immed::LDX);
+
+        string label;
+        uint16_t top = BeginSelfReferences(label);
+        PatchSelfReference(Abs::STA, reset, top, label, 2);
+        m_cpu.Emit(AbsX::STA, dst);
+        m_cpu.Emit(Implied::INX);
+        EmitBranch(Rel::BNE, top);
+        uint32_t page = 256 * (Cyc(AbsX::STA) + Cyc(Implied::INX))
+            + 255 * TakenCycles(m_cpu.CurrentAddress, top)
+            + Cyc(Rel::BNE);
+
+        EmitSelfReference(Abs::INC, top, label, 2);
+        m_cpu.Emit(Implied::DEY);
+        EmitBranch(Rel::BNE, top);
+        cycles += pages * (page + Cyc(Abs::INC) + Cyc(Implied::DEY))
+            + (pages - 1) * TakenCycles(m_cpu.CurrentAddress, top)
+            + Cyc(Rel::BNE);
+
+        if (rest > 0)
+        {
+            uint16_t restTop = BeginCountdown(rest);
+            m_cpu.Emit(AbsX::STA, IndexBase(static_cast<uint16_t>(dst + pages * 256), rest));
+            cycles += rest * Cyc(AbsX::STA) + EndCountdown(restTop, rest);
+        }
+    }
+    else
+    {
+        m_cpu.Emit(Immed::LDA, value);
+        cycles += Cyc(Immed::LDA);
+
+        // `ways` stores per iteration, each covering its own run of `iterations` bytes; whatever
+        // doesn't divide evenly is stored straight-line ahead of the loop.
+        uint32_t ways = (variant.Form == Form::Loop) ? (count + 255) / 256 : variant.Unroll;
+        uint32_t iterations = (ways == 0) ? 0 : count / ways;
+        if (iterations > 256)
+            throw new exception("unroll factor is too small for this many bytes");
+        if (iterations < 2)
+            iterations = ways = 0;
+
+        for (uint32_t i = ways * iterations; i < count; i++)
+        {
+            cycles += EmitZPOrAbs(m_cpu, ZP::STA, Abs::STA, static_cast<uint16_t>(dst + i));
+        }
+
+        if (iterations > 0)
+        {
+            uint16_t top = BeginCountdown(iterations);
+            for (uint32_t w = 0; w < ways; w++)
+            {
+                m_cpu.Emit(AbsX::STA, IndexBase(static_cast<uint16_t>(dst + w * iterations), iterations));
+            }
+            cycles += ways * iterations * Cyc(AbsX::STA) + EndCountdown(top, iterations);
+        }
+    }
+
+    Cost cost = { static_cast<uint16_t>(m_cpu.CurrentAddress - start), cycles, cycles };
+    return cost;
+}
+
+Routines::Cost Routines::Copy(uint16_t src, uint16_t dst, uint16_t count, const Variant& variant)
+{
+    uint16_t start = m_cpu.CurrentAddress;
+    uint32_t cycles = 0;
+
+    if (variant.Form == Form::SelfModifying)
+    {
+        uint32_t pages = count / 256;
+        uint32_t rest = count % 256;
+        if (pages == 0)
+            throw new exception("the self-modifying form needs at least one full page");
+
+        // Reset the operands the loop increments, so the routine can be run more than once.
+        m_cpu.Emit(Immed::LDA, static_cast<uint8_t>(src >> 8));
+        uint16_t resetSrc = m_cpu.CurrentAddress;
+        m_cpu.Emit(Abs::STA, static_cast<uint16_t>(0));
+        m_cpu.Emit(Immed::LDA, static_cast<uint8_t>(dst >> 8));
+        uint16_t resetDst = m_cpu.CurrentAddress;
+        m_cpu.Emit(Abs::STA, static_cast<uint16_t>(0));
+        m_cpu.Emit(Immed::LDY, static_cast<uint8_t>(pages));
+        m_cpu.Emit(Immed::LDX, static_cast<uint8_t>(0));
+        cycles += 2 * (Cyc(Immed::LDA) + Cyc(Abs::STA)) + Cyc(Immed::LDY) + Cyc(Immed::LDX);
+
+        string label;
+        uint16_t top = BeginSelfReferences(label);
+        PatchSelfReference(Abs::STA, resetSrc, top, label, 2);
+        PatchSelfReference(Abs::STA, resetDst, top, label, 5);
+        m_cpu.Emit(AbsX::LDA, src);
+        m_cpu.Emit(AbsX::STA, dst);
+        m_cpu.Emit(Implied::INX);
+        EmitBranch(Rel::BNE, top);
+        uint32_t page = 256 * (Cyc(AbsX::LDA) + Cyc(AbsX::STA) + Cyc(Implied::INX))
+            + IndexCrossings(src, 256)
+            + 255 * TakenCycles(m_cpu.CurrentAddress, top)
+            + Cyc(Rel::BNE);
+
+        EmitSelfReference(Abs::INC, top, label, 2);
+        EmitSelfReference(Abs::INC, top, label, 5);
+        m_cpu.Emit(Implied::DEY);
+        EmitBranch(Rel::BNE, top);
+        cycles += pages * (page + 2 * Cyc(Abs::INC) + Cyc(Implied::DEY))
+            + (pages - 1) * TakenCycles(m_cpu.CurrentAddress, top)
+            + Cyc(Rel::BNE);
+
+        if (rest > 0)
+        {
+            uint16_t from = IndexBase(static_cast<uint16_t>(src + pages * 256), rest);
+            uint16_t restTop = BeginCountdown(rest);
+            m_cpu.Emit(AbsX::LDA, from);
+            m_cpu.Emit(AbsX::STA, IndexBase(static_cast<uint16_t>(dst + pages * 256), rest));
+            cycles += rest * (Cyc(AbsX::LDA) + Cyc(AbsX::STA)) + IndexCrossings(from, rest)
+                + EndCountdown(restTop, rest);
+        }
+    }
+    else
+    {
+        uint32_t ways = (variant.Form == Form::Loop) ? (count + 255) / 256 : variant.Unroll;
+        uint32_t iterations = (ways == 0) ? 0 : count / ways;
+        if (iterations > 256)
+            throw new exception("unroll factor is too small for this many bytes");
+        if (iterations < 2)
+            iterations = ways = 0;
+
+        for (uint32_t i = ways * iterations; i < count; i++)
+        {
+            cycles += EmitZPOrAbs(m_cpu, ZP::LDA, Abs::LDA, static_cast<uint16_t>(src + i));
+            cycles += EmitZPOrAbs(m_cpu, ZP::STA, Abs::STA, static_cast<uint16_t>(dst + i));
+        }
+
+        if (iterations > 0)
+        {
+            uint16_t top = BeginCountdown(iterations);
+            for (uint32_t w = 0; w < ways; w++)
+            {
+                uint16_t from = IndexBase(static_cast<uint16_t>(src + w * iterations), iterations);
+                m_cpu.Emit(AbsX::LDA, from);
+                m_cpu.Emit(AbsX::STA, IndexBase(static_cast<uint16_t>(dst + w * iterations), iterations));
+                cycles += iterations * (Cyc(AbsX::LDA) + Cyc(AbsX::STA)) + IndexCrossings(from, iterations);
+            }
+            cycles += EndCountdown(top, iterations);
+        }
+    }
+
+    Cost cost = { static_cast<uint16_t>(m_cpu.CurrentAddress - start), cycles, cycles };
+    return cost;
+}
+
+Routines::Cost Routines::ClearScreen(uint8_t color, const Variant& variant)
+{
+    Cost screen = Fill(VIC_ScreenRAM, VIC_ScreenSize, 0x20, variant);    // 0x20 is a space
+    Cost colors = Fill(VIC_ColorRAM, VIC_ScreenSize, color, variant);
+    Cost cost = {
+        screen.Bytes + colors.Bytes,
+        screen.MinCycles + colors.MinCycles,
+        screen.MaxCycles + colors.MaxCycles
+    };
+    return cost;
+}
+
+Routines::Cost Routines::Add16(uint16_t a, uint16_t b, uint16_t result)
+{
+    uint16_t start = m_cpu.CurrentAddress;
+    m_cpu.Emit(Implied::CLC);
+    uint32_t cycles = Cyc(Implied::CLC);
+    for (uint16_t i = 0; i < 2; i++)
+    {
+        cycles += EmitZPOrAbs(m_cpu, ZP::LDA, Abs::LDA, static_cast<uint16_t>(a + i));
+        cycles += EmitZPOrAbs(m_cpu, ZP::ADC, Abs::ADC, static_cast<uint16_t>(b + i));
+        cycles += EmitZPOrAbs(m_cpu, ZP::STA, Abs::STA, static_cast<uint16_t>(result + i));
+    }
+
+    Cost cost = { static_cast<uint16_t>(m_cpu.CurrentAddress - start), cycles, cycles };
+    return cost;
+}
+
+Routines::Cost Routines::Compare16(uint16_t a, uint16_t b)
+{
+    uint16_t start = m_cpu.CurrentAddress;
+
+    // High bytes first; only if they're equal do the low bytes decide.
+    uint32_t high = EmitZPOrAbs(m_cpu, ZP::LDA, Abs::LDA, static_cast<uint16_t>(a + 1));
+    high += EmitZPOrAbs(m_cpu, ZP::CMP, Abs::CMP, static_cast<uint16_t>(b + 1));
+    uint16_t branch = m_cpu.CurrentAddress;
+    m_cpu.Emit(Rel::BNE, static_cast<uint8_t>(0));
+    uint32_t low = EmitZPOrAbs(m_cpu, ZP::LDA, Abs::LDA, a);
+    low += EmitZPOrAbs(m_cpu, ZP::CMP, Abs::CMP, b);
+    PatchBranch(Rel::BNE, branch);
+
+    uint32_t differ = high + TakenCycles(branch + 2, m_cpu.CurrentAddress);
+    uint32_t equal = high + Cyc(Rel::BNE) + low;
+    Cost cost = { static_cast<uint16_t>(m_cpu.CurrentAddress - start), min(differ, equal), max(differ, equal) };
+    return cost;
+}
+
+Routines::Cost Routines::Multiply8(uint8_t multiplier, uint8_t multiplicand, uint8_t productHigh, const Variant& variant)
+{
+    uint32_t copies = (variant.Form == Form::Loop) ? 1 : (variant.Unroll == 0 ? 8 : variant.Unroll);
+    if (variant.Form == Form::SelfModifying || copies > 8 || 8 % copies != 0)
+        throw new exception("multiply can only be unrolled 1, 2, 4 or 8 times");
+    uint32_t iterations = 8 / copies;
+
+    // Shift-and-add: A accumulates the high byte while the multiplier shifts out to the right and
+    // the low byte of the product shifts in from the left.
+    uint16_t start = m_cpu.CurrentAddress;
+    m_cpu.Emit(Immed::LDA, static_cast<uint8_t>(0));
+    m_cpu.Emit(ZP::LSR, multiplier);
+    uint32_t fixed = Cyc(Immed::LDA) + Cyc(ZP::LSR);
+
+    uint16_t top = (iterations > 1) ? BeginCountdown(iterations) : m_cpu.CurrentAddress;
+    uint32_t minBody = 0;
+    uint32_t maxBody = 0;
+    for (uint32_t c = 0; c < copies; c++)
+    {
+        uint16_t branch = m_cpu.CurrentAddress;
+        m_cpu.Emit(Rel::BCC, static_cast<uint8_t>(0));
+        m_cpu.Emit(Implied::CLC);
+        m_cpu.Emit(ZP::ADC, multiplicand);
+        PatchBranch(Rel::BCC, branch);
+        m_cpu.Emit(A::ROR);
+        m_cpu.Emit(ZP::ROR, multiplier);
+
+        uint32_t add = Cyc(Rel::BCC) + Cyc(Implied::CLC) + Cyc(ZP::ADC);
+        uint32_t skip = TakenCycles(branch + 2, branch + 5);
+        uint32_t shift = Cyc(A::ROR) + Cyc(ZP::ROR);
+        minBody += min(add, skip) + shift;
+        maxBody += max(add, skip) + shift;
+    }
+    if (iterations > 1)
+        fixed += EndCountdown(top, iterations);
+
+    m_cpu.Emit(ZP::STA, productHigh);
+    fixed += Cyc(ZP::STA);
+
+    Cost cost = {
+        static_cast<uint16_t>(m_cpu.CurrentAddress - start),
+        fixed + iterations * minBody,
+        fixed + iterations * maxBody
+    };
+    return cost;
+}
+
+Routines::Cost Routines::Divide16(uint8_t dividend, uint8_t divisor, uint8_t remainder, const Variant& variant)
+{
+    uint32_t copies = (variant.Form == Form::Loop) ? 1 : (variant.Unroll == 0 ? 16 : variant.Unroll);
+    if (variant.Form == Form::SelfModifying || copies > 16 || 16 % copies != 0)
+        throw new exception("divide can only be unrolled 1, 2, 4, 8 or 16 times");
+    if (dividend == 0xff)
+        throw new exception("16-bit dividend must fit in the zero page");
+    uint32_t iterations = 16 / copies;
+
+    // Shift-and-subtract: the dividend shifts left into A, and each time A reaches the divisor it
+    // is subtracted and a quotient bit is set in the vacated low bit of the dividend.
+    uint16_t start = m_cpu.CurrentAddress;
+    m_cpu.Emit(Immed::LDA, static_cast<uint8_t>(0));
+    uint32_t fixed = Cyc(Immed::LDA);
+
+    uint16_t top = (iterations > 1) ? BeginCountdown(iterations) : m_cpu.CurrentAddress;
+    uint32_t minBody = 0;
+    uint32_t maxBody = 0;
+    for (uint32_t c = 0; c < copies; c++)
+    {
+        m_cpu.Emit(ZP::ASL, dividend);
+        m_cpu.Emit(ZP::ROL, static_cast<uint8_t>(dividend + 1));
+        m_cpu.Emit(A::ROL);
+        uint16_t overflow = m_cpu.CurrentAddress;
+        m_cpu.Emit(Rel::BCS, static_cast<uint8_t>(0));
+        m_cpu.Emit(ZP::CMP, divisor);
+        uint16_t below = m_cpu.CurrentAddress;
+        m_cpu.Emit(Rel::BCC, static_cast<uint8_t>(0));
+        uint16_t subtract = m_cpu.CurrentAddress;
+        PatchBranch(Rel::BCS, overflow);
+        m_cpu.Emit(ZP::SBC, divisor);
+        m_cpu.Emit(ZP::INC, dividend);
+        PatchBranch(Rel::BCC, below);
+
+        uint32_t shift = Cyc(ZP::ASL) + Cyc(ZP::ROL) + Cyc(A::ROL);
+        uint32_t sub = Cyc(ZP::SBC) + Cyc(ZP::INC);
+        uint32_t carried = TakenCycles(overflow + 2, subtract) + sub;
+        uint32_t fits = Cyc(Rel::BCS) + Cyc(ZP::CMP) + Cyc(Rel::BCC) + sub;
+        uint32_t smaller = Cyc(Rel::BCS) + Cyc(ZP::CMP) + TakenCycles(below + 2, m_cpu.CurrentAddress);
+        minBody += shift + min(min(carried, fits), smaller);
+        maxBody += shift + max(max(carried, fits), smaller);
+    }
+    if (iterations > 1)
+        fixed += EndCountdown(top, iterations);
+
+    m_cpu.Emit(ZP::STA, remainder);
+    fixed += Cyc(ZP::STA);
+
+    Cost cost = {
+        static_cast<uint16_t>(m_cpu.CurrentAddress - start),
+        fixed + iterations * minBody,
+        fixed + iterations * maxBody
+    };
+    return cost;
+}
+
+Routines::Cost Routines::Choose(const Budget& budget, const vector<Variant>& candidates, const Generator& generate)
+{
+    uint16_t origin = m_cpu.CurrentAddress;
+    uint32_t limit = static_cast<uint32_t>(min<uint64_t>(1 << 16, static_cast<uint64_t>(origin) + budget.MaxBytes));
+    if (limit <= origin)
+        throw new exception("no routine variant fits the budget");
+
+    // Try each candidate in a scratch buffer at the same address, so that branch and page-crossing
+    // penalties come out exactly as they will for real. The buffer's limit rejects oversized
+    // variants as soon as they outgrow the budget.
+    auto scratch = make_shared<CodeBuffer>();
+    scratch->AddSection("scratch", origin, limit);
+    CodeBuffer::Mark empty = scratch->GetMark();
+    Asm6502 cpu(scratch);
+    Routines routines(cpu);
+
+    const Variant* best = nullptr;
+    Cost bestCost = {};
+    for (const auto& candidate : candidates)
+    {
+        if (candidate.Form == Form::SelfModifying && !budget.AllowSelfModifying)
+            continue;
+
+        scratch->Rollback(empty);
+        cpu.CurrentAddress = origin;
+
+        Cost cost;
+        try
+        {
+            cost = generate(routines, candidate);
+        }
+        catch (exception* e)
+        {
+            // Too big for the buffer, or not a valid form for these arguments.
+            delete e;
+            continue;
+        }
+
+        if (cost.Bytes > budget.MaxBytes || cost.MaxCycles > budget.MaxCycles)
+            continue;
+
+        bool better;
+        if (best == nullptr)
+            better = true;
+        else if (budget.PreferSize)
+            better = cost.Bytes < bestCost.Bytes
+                || (cost.Bytes == bestCost.Bytes && cost.MaxCycles < bestCost.MaxCycles);
+        else
+            better = cost.MaxCycles < bestCost.MaxCycles
+                || (cost.MaxCycles == bestCost.MaxCycles && cost.Bytes < bestCost.Bytes);
+
+        if (better)
+        {
+            best = &candidate;
+            bestCost = cost;
+        }
+    }
+
+    if (best == nullptr)
+        throw new exception("no routine variant fits the budget");
+    return generate(*this, *best);
+}
+
+static const Routines::Variant g_blockVariants[] = {
+    { Routines::Form::Loop, 0 },
+    { Routines::Form::Unrolled, 2 },
+    { Routines::Form::Unrolled, 4 },
+    { Routines::Form::Unrolled, 8 },
+    { Routines::Form::Unrolled, 16 },
+    { Routines::Form::SelfModifying, 0 },
+    { Routines::Form::Unrolled, 0 },
+};
+
+static const Routines::Variant g_multiplyVariants[] = {
+    { Routines::Form::Loop, 0 },
+    { Routines::Form::Unrolled, 2 },
+    { Routines::Form::Unrolled, 4 },
+    { Routines::Form::Unrolled, 0 },
+};
+
+static const Routines::Variant g_divideVariants[] = {
+    { Routines::Form::Loop, 0 },
+    { Routines::Form::Unrolled, 2 },
+    { Routines::Form::Unrolled, 4 },
+    { Routines::Form::Unrolled, 8 },
+    { Routines::Form::Unrolled, 0 },
+};
+
+Routines::Cost Routines::Fill(uint16_t dst, uint16_t count, uint8_t value, const Budget& budget)
+{
+    vector<Variant> candidates(begin(g_blockVariants), end(g_blockVariants));
+    return Choose(budget, candidates, [=](Routines& r, const Variant& v) { return r.Fill(dst, count, value, v); });
+}
+
+Routines::Cost Routines::Copy(uint16_t src, uint16_t dst, uint16_t count, const Budget& budget)
+{
+    vector<Variant> candidates(begin(g_blockVariants), end(g_blockVariants));
+    return Choose(budget, candidates, [=](Routines& r, const Variant& v) { return r.Copy(src, dst, count, v); });
+}
+
+Routines::Cost Routines::ClearScreen(uint8_t color, const Budget& budget)
+{
+    vector<Variant> candidates(begin(g_blockVariants), end(g_blockVariants));
+    return Choose(budget, candidates, [=](Routines& r, const Variant& v) { return r.ClearScreen(color, v); });
+}
+
+Routines::Cost Routines::Multiply8(uint8_t multiplier, uint8_t multiplicand, uint8_t productHigh, const Budget& budget)
+{
+    vector<Variant> candidates(begin(g_multiplyVariants), end(g_multiplyVariants));
+    return Choose(budget, candidates, [=](Routines& r, const Variant& v) {
+        return r.Multiply8(multiplier, multiplicand, productHigh, v);
+    });
+}
+
+Routines::Cost Routines::Divide16(uint8_t dividend, uint8_t divisor, uint8_t remainder, const Budget& budget)
+{
+    vector<Variant> candidates(begin(g_divideVariants), end(g_divideVariants));
+    return Choose(budget, candidates, [=](Routines& r, const Variant& v) {
+        return r.Divide16(dividend, divisor, remainder, v);
+    });
+}
\ No newline at end of file
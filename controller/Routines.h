@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Asm6502.h"
+
+// Generators for common routines, emitted through Asm6502 at its CurrentAddress.
+//
+// Most routines come in several forms trading size for speed. Every generator returns the exact
+// number of bytes it emitted and the exact best- and worst-case cycle counts of the emitted code
+// (including branch and page-crossing penalties), so callers can either pick a Variant themselves
+// or hand over a Budget and let the fastest (or smallest) fitting variant be chosen.
+//
+// Cycle counts depend on where the code ends up (branches and indexed accesses that cross a page
+// cost extra), and assume CurrentAddress is the final address. Over an ObjectModule, where it is
+// only an offset into a section, the counts are estimates until the section is placed.
+class Routines
+{
+public:
+    enum class Form : uint8_t
+    {
+        Loop,           // Smallest: as few instructions as possible per iteration
+        Unrolled,       // Unroll copies of the loop body per iteration; 0 means no loop at all
+        SelfModifying,  // Walks whole pages by incrementing its own operands (Fill and Copy only;
+                        // the code must run from RAM)
+    };
+
+    struct Variant
+    {
+        Form Form;
+        uint16_t Unroll;
+    };
+
+    struct Cost
+    {
+        uint32_t Bytes;
+        uint32_t MinCycles;
+        uint32_t MaxCycles;
+    };
+
+    // Use UINT32_MAX for an unconstrained dimension.
+    struct Budget
+    {
+        Budget(uint32_t maxBytes = UINT32_MAX, uint32_t maxCycles = UINT32_MAX, bool preferSize = false,
+            bool allowSelfModifying = false)
+            : MaxBytes(maxBytes)
+            , MaxCycles(maxCycles)
+            , PreferSize(preferSize)
+            , AllowSelfModifying(allowSelfModifying)
+        {
+        }
+
+        uint32_t MaxBytes;
+        uint32_t MaxCycles;
+        bool PreferSize;    // pick the smallest fitting variant rather than the fastest
+        bool AllowSelfModifying;    // only for code that will run from RAM, not cartridge ROM
+    };
+
+    Routines(Asm6502& cpu);
+
+    // Fills count bytes at dst with value. Clobbers A, X (and Y for SelfModifying).
+    Cost Fill(uint16_t dst, uint16_t count, uint8_t value, const Variant& variant);
+    Cost Fill(uint16_t dst, uint16_t count, uint8_t value, const Budget& budget);
+
+    // Copies count bytes from src to dst; the ranges must not overlap. Clobbers A, X (and Y for
+    // SelfModifying).
+    Cost Copy(uint16_t src, uint16_t dst, uint16_t count, const Variant& variant);
+    Cost Copy(uint16_t src, uint16_t dst, uint16_t count, const Budget& budget);
+
+    // Fills the screen with spaces and the color RAM with the given color.
+    Cost ClearScreen(uint8_t color, const Variant& variant);
+    Cost ClearScreen(uint8_t color, const Budget& budget);
+
+    // result = a + b, all little-endian 16-bit values. Clobbers A and C.
+    Cost Add16(uint16_t a, uint16_t b, uint16_t result);
+
+    // Unsigned compare of a with b: C is set if a >= b, Z is set if a == b. Clobbers A.
+    Cost Compare16(uint16_t a, uint16_t b);
+
+    // 8x8 -> 16-bit unsigned multiply of two zero page bytes. The low byte of the product replaces
+    // the multiplier; the high byte is stored at productHigh. Clobbers A and X.
+    Cost Multiply8(uint8_t multiplier, uint8_t multiplicand, uint8_t productHigh, const Variant& variant);
+    Cost Multiply8(uint8_t multiplier, uint8_t multiplicand, uint8_t productHigh, const Budget& budget);
+
+    // 16 / 8-bit unsigned divide. The 16-bit zero page dividend is replaced by the quotient and the
+    // remainder is stored at remainder. Clobbers A and X.
+    Cost Divide16(uint8_t dividend, uint8_t divisor, uint8_t remainder, const Variant& variant);
+    Cost Divide16(uint8_t dividend, uint8_t divisor, uint8_t remainder, const Budget& budget);
+
+private:
+    typedef std::function<Cost(Routines&, const Variant&)> Generator;
+
+    Cost Choose(const Budget& budget, const std::vector<Variant>& candidates, const Generator& generate);
+
+    uint16_t BeginCountdown(uint32_t iterations);
+    uint32_t EndCountdown(uint16_t top, uint32_t iterations);
+    void EmitBranch(Asm6502::InstrRel instr, uint16_t target);
+    void PatchBranch(Asm6502::InstrRel instr, uint16_t at);
+
+    // Operands pointing into the routine itself (for the self-modifying forms). Over an
+    // ObjectModule they become relocations against a local label at the routine's loop.
+    uint16_t BeginSelfReferences(std::string& label);
+    void EmitSelfReference(Asm6502::InstrAbs instr, uint16_t base, const std::string& label, uint16_t offset);
+    void PatchSelfReference(Asm6502::InstrAbs instr, uint16_t at, uint16_t base, const std::string& label, uint16_t offset);
+
+    Asm6502& m_cpu;
+};
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include <cstdint>
+#include <cctype>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <memory>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "MappedFile.h"
+#include "SignatureSearch.h"
+
+using namespace std;
+
+using Instruction = Asm6502::Instruction;
+using Mode = Asm6502::Mode;
+
+// More distinct anchor bytes than this and a 256-entry table lookup per byte is faster.
+static const size_t MaxSimdAnchors = 16;
+
+static uint32_t ModeBit(Mode mode)
+{
+    return 1u << static_cast<uint32_t>(mode);
+}
+
+static const uint32_t AllModes = (1u << static_cast<uint32_t>(Mode::MAX_VALUE)) - 1;
+static const uint32_t ZeroPageModes = ModeBit(Mode::ZP) | ModeBit(Mode::ZPX) | ModeBit(Mode::ZPY)
+    | ModeBit(Mode::IndX) | ModeBit(Mode::IndY);
+static const uint32_t AbsoluteModes = ModeBit(Mode::Abs) | ModeBit(Mode::AbsX) | ModeBit(Mode::AbsY)
+    | ModeBit(Mode::Ind);
+
+static int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Parses up to four hex digits, or all '?' for a wildcard. Returns the number of digits, or 0 if
+// the text isn't valid.
+static size_t ParseHex(const string& text, uint16_t& value, bool& wildcard)
+{
+    if (text.empty() || text.size() > 4)
+        return 0;
+
+    value = 0;
+    wildcard = (text.find_first_not_of('?') == string::npos);
+    if (!wildcard)
+    {
+        for (char c : text)
+        {
+            int digit = HexDigit(c);
+            if (digit < 0)
+                return 0;
+            value = static_cast<uint16_t>((value << 4) | digit);
+        }
+    }
+    return text.size();
+}
+
+static bool EndsWith(const string& s, const char* suffix)
+{
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+static unsigned LowestSetBit(uint32_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+size_t SignatureSearch::AddBytePattern(const string& text)
+{
+    Pattern pattern = {};
+    pattern.IsInstruction = false;
+
+    size_t pos = 0;
+    while ((pos = text.find_first_not_of(" \t", pos)) != string::npos)
+    {
+        size_t end = text.find_first_of(" \t", pos);
+        string token = text.substr(pos, end - pos);
+        pos = end;
+
+        uint16_t value;
+        bool wildcard;
+        if (token.size() != 2 || ParseHex(token, value, wildcard) != 2)
+            throw new exception("byte patterns are two-digit hex bytes or ??, separated by spaces");
+        pattern.Bytes.push_back(static_cast<uint8_t>(value));
+        pattern.Mask.push_back(wildcard ? 0 : 0xff);
+    }
+
+    pattern.Anchor = find(pattern.Mask.begin(), pattern.Mask.end(), 0xff) - pattern.Mask.begin();
+    if (pattern.Anchor == pattern.Mask.size())
+        throw new exception("byte pattern needs at least one byte that isn't a wildcard");
+
+    size_t index = m_patterns.size();
+    m_patterns.push_back(pattern);
+    AddAnchor(pattern.Bytes[pattern.Anchor], index);
+    return index;
+}
+
+size_t SignatureSearch::AddInstructionPattern(const string& text)
+{
+    size_t start = text.find_first_not_of(" \t");
+    if (start == string::npos)
+        throw new exception("instruction pattern is empty");
+    size_t space = text.find_first_of(" \t", start);
+    Instruction instr = Asm6502::ParseMnemonic(text.substr(start, space - start));
+    if (instr == Instruction::INVALID)
+        throw new exception("unknown instruction mnemonic");
+
+    string operand;
+    if (space != string::npos)
+    {
+        for (size_t i = space; i < text.size(); i++)
+        {
+            if (!isspace(static_cast<unsigned char>(text[i])))
+                operand += static_cast<char>(toupper(static_cast<unsigned char>(text[i])));
+        }
+    }
+
+    Pattern pattern = {};
+    pattern.IsInstruction = true;
+    pattern.Instruction = instr;
+    if (operand.empty())
+    {
+        pattern.Modes = AllModes;
+        pattern.AnyOperand = true;
+    }
+    else if (operand == "A")
+    {
+        pattern.Modes = ModeBit(Mode::A);
+        pattern.AnyOperand = true;
+    }
+    else
+    {
+        // Peel the addressing mode syntax off the number.
+        string number;
+        if (operand[0] == '#')
+        {
+            pattern.Modes = ModeBit(Mode::Immed);
+            number = operand.substr(1);
+        }
+        else if (operand[0] == '(' && EndsWith(operand, ",X)"))
+        {
+            pattern.Modes = ModeBit(Mode::IndX);
+            number = operand.substr(1, operand.size() - 4);
+        }
+        else if (operand[0] == '(' && EndsWith(operand, "),Y"))
+        {
+            pattern.Modes = ModeBit(Mode::IndY);
+            number = operand.substr(1, operand.size() - 4);
+        }
+        else if (operand[0] == '(' && EndsWith(operand, ")"))
+        {
+            pattern.Modes = ModeBit(Mode::Ind);
+            number = operand.substr(1, operand.size() - 2);
+        }
+        else if (EndsWith(operand, ",X"))
+        {
+            pattern.Modes = ModeBit(Mode::ZPX) | ModeBit(Mode::AbsX);
+            number = operand.substr(0, operand.size() - 2);
+        }
+        else if (EndsWith(operand, ",Y"))
+        {
+            pattern.Modes = ModeBit(Mode::ZPY) | ModeBit(Mode::AbsY);
+            number = operand.substr(0, operand.size() - 2);
+        }
+        else
+        {
+            pattern.Modes = ZeroPageModes | AbsoluteModes;
+            number = operand;
+        }
+
+        size_t digits = (number.size() > 1 && number[0] == '$')
+            ? ParseHex(number.substr(1), pattern.Operand, pattern.AnyOperand)
+            : 0;
+        if (digits == 0)
+            throw new exception("operand must be a $-prefixed hex number, or ?? for any");
+
+        if (pattern.AnyOperand)
+        {
+            // The number of ?s says how wide the operand is. Only a bare "$??" covers branches.
+            if (digits > 2)
+                pattern.Modes &= AbsoluteModes;
+            else if (pattern.Modes == (ZeroPageModes | AbsoluteModes))
+                pattern.Modes = ZeroPageModes | ModeBit(Mode::Rel);
+            else
+                pattern.Modes &= ~AbsoluteModes;
+        }
+        else if (pattern.Operand > 0xff)
+        {
+            pattern.Modes &= AbsoluteModes;
+        }
+    }
+
+    uint32_t available = 0;
+    for (uint32_t m = 0; m < static_cast<uint32_t>(Mode::MAX_VALUE); m++)
+    {
+        if (Asm6502::Opcode(instr, static_cast<Mode>(m)) != static_cast<uint8_t>(Instruction::INVALID))
+            available |= 1u << m;
+    }
+    pattern.Modes &= available;
+    if (pattern.Modes == 0)
+        throw new exception("instruction has no addressing mode matching the operand");
+
+    size_t index = m_patterns.size();
+    m_patterns.push_back(pattern);
+    for (uint32_t m = 0; m < static_cast<uint32_t>(Mode::MAX_VALUE); m++)
+    {
+        if (pattern.Modes & (1u << m))
+            AddAnchor(Asm6502::Opcode(instr, static_cast<Mode>(m)), index);
+    }
+    return index;
+}
+
+void SignatureSearch::AddAnchor(uint8_t byte, size_t pattern)
+{
+    if (m_anchored[byte].empty())
+        m_anchorBytes.push_back(byte);
+    m_anchored[byte].push_back(pattern);
+}
+
+void SignatureSearch::TryAt(const uint8_t* data, size_t size, size_t offset, size_t file, vector<Match>& matches) const
+{
+    for (size_t p : m_anchored[data[offset]])
+    {
+        const Pattern& pattern = m_patterns[p];
+        size_t start = offset;
+        if (pattern.IsInstruction)
+        {
+            pair<Instruction, Mode> decoded = Asm6502::Decode(data[offset]);
+            if (decoded.first != pattern.Instruction || !(pattern.Modes & ModeBit(decoded.second)))
+                continue;
+
+            size_t length = Asm6502::Length(decoded.second);
+            if (length > size - offset)
+                continue;
+            if (!pattern.AnyOperand)
+            {
+                uint16_t operand = (length == 2)
+                    ? data[offset + 1]
+                    : static_cast<uint16_t>(data[offset + 1] | (data[offset + 2] << 8));
+                if (operand != pattern.Operand)
+                    continue;
+            }
+        }
+        else
+        {
+            if (offset < pattern.Anchor)
+                continue;
+            start = offset - pattern.Anchor;
+            size_t length = pattern.Bytes.size();
+            if (length > size - start)
+                continue;
+
+            size_t i = 0;
+            while (i < length && (data[start + i] & pattern.Mask[i]) == pattern.Bytes[i])
+                i++;
+            if (i != length)
+                continue;
+        }
+
+        Match match = { file, start, p };
+        matches.push_back(match);
+    }
+}
+
+void SignatureSearch::Scan(const uint8_t* data, size_t size, size_t file, vector<Match>& matches) const
+{
+    size_t i = 0;
+
+#ifdef HAVE_SSE2
+    size_t nAnchors = m_anchorBytes.size();
+    if (nAnchors > 0 && nAnchors <= MaxSimdAnchors)
+    {
+        __m128i needles[MaxSimdAnchors];
+        for (size_t j = 0; j < nAnchors; j++)
+            needles[j] = _mm_set1_epi8(static_cast<char>(m_anchorBytes[j]));
+
+        for (; i + 16 <= size; i += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i hits = _mm_cmpeq_epi8(block, needles[0]);
+            for (size_t j = 1; j < nAnchors; j++)
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[j]));
+
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+            while (mask != 0)
+            {
+                TryAt(data, size, i + LowestSetBit(mask), file, matches);
+                mask &= mask - 1;
+            }
+        }
+    }
+#endif
+
+    for (; i < size; i++)
+    {
+        if (!m_anchored[data[i]].empty())
+            TryAt(data, size, i, file, matches);
+    }
+}
+
+SignatureSearch::Result SignatureSearch::Search(const vector<wstring>& files, unsigned threads) const
+{
+    if (threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+    threads = static_cast<unsigned>(min<size_t>(threads, max<size_t>(files.size(), 1)));
+
+    // Each worker takes the next file off a shared counter, and collects its own results.
+    atomic<size_t> next(0);
+    vector<vector<Match>> found(threads);
+    vector<vector<size_t>> unreadable(threads);
+    auto worker = [&](unsigned t)
+    {
+        for (size_t f = next++; f < files.size(); f = next++)
+        {
+            try
+            {
+                MappedFile file(files[f]);
+                Scan(file.Data(), file.Size(), f, found[t]);
+            }
+            catch (exception* e)
+            {
+                delete e;
+                unreadable[t].push_back(f);
+            }
+        }
+    };
+
+    vector<thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+        pool.push_back(thread(worker, t));
+    worker(0);
+    for (auto& th : pool)
+        th.join();
+
+    Result result;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        result.Matches.insert(result.Matches.end(), found[t].begin(), found[t].end());
+        result.Unreadable.insert(result.Unreadable.end(), unreadable[t].begin(), unreadable[t].end());
+    }
+    sort(result.Matches.begin(), result.Matches.end(), [](const Match& a, const Match& b)
+    {
+        if (a.File != b.File)
+            return a.File < b.File;
+        if (a.Offset != b.Offset)
+            return a.Offset < b.Offset;
+        return a.Pattern < b.Pattern;
+    });
+    sort(result.Unreadable.begin(), result.Unreadable.end());
+    return result;
+}
\ No newline at end of file
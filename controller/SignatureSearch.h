@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Asm6502.h"
+
+// Searches ROM images for byte patterns (with wildcards) and instruction patterns.
+//
+// Every pattern has an anchor byte: the first fixed byte of a byte pattern, or the opcode(s) of an
+// instruction pattern. Images are scanned for anchor bytes with an SSE2 prefilter, and patterns are
+// only checked (instruction patterns by decoding the opcode) where an anchor byte turns up. Search()
+// maps each file into memory and spreads the files across threads.
+class SignatureSearch
+{
+public:
+    struct Match
+    {
+        size_t File;
+        size_t Offset;
+        size_t Pattern;
+    };
+
+    struct Result
+    {
+        std::vector<Match> Matches;         // sorted by file, offset, then pattern
+        std::vector<size_t> Unreadable;     // files that couldn't be opened or mapped, sorted
+    };
+
+    // Hex bytes separated by spaces, with "??" for a wildcard: "8d 0f 90", "a9 ?? 8d 0f 90".
+    // Returns the pattern's index.
+    size_t AddBytePattern(const std::string& text);
+
+    // An instruction, optionally with an operand. "STA $900F" matches every addressing mode of STA
+    // that can have $900F as its operand; "JSR" alone matches any operand. Writing the operand in a
+    // specific mode ("#$00", "$10,X", "($fb),Y", "A", ...) matches only that mode, and "??" or
+    // "????" in place of the digits matches any 8- or 16-bit operand. Returns the pattern's index.
+    size_t AddInstructionPattern(const std::string& text);
+
+    // Appends the matches in one image to `matches`, in scan order.
+    void Scan(const uint8_t* data, size_t size, size_t file, std::vector<Match>& matches) const;
+
+    // Scans every file, using the given number of threads (0 for one per core).
+    Result Search(const std::vector<std::wstring>& files, unsigned threads = 0) const;
+
+private:
+    struct Pattern
+    {
+        bool IsInstruction;
+
+        // Byte patterns
+        std::vector<uint8_t> Bytes;
+        std::vector<uint8_t> Mask;      // 0xff where the byte must match, 0 for a wildcard
+        size_t Anchor;                  // index of the first byte that must match
+
+        // Instruction patterns
+        Asm6502::Instruction Instruction;
+        uint32_t Modes;                 // bit per Asm6502::Mode
+        bool AnyOperand;
+        uint16_t Operand;
+    };
+
+    void AddAnchor(uint8_t byte, size_t pattern);
+    void TryAt(const uint8_t* data, size_t size, size_t offset, size_t file, std::vector<Match>& matches) const;
+
+    std::vector<Pattern> m_patterns;
+    std::vector<size_t> m_anchored[256];    // patterns to try wherever their anchor byte is found
+    std::vector<uint8_t> m_anchorBytes;     // distinct anchor bytes, for the prefilter
+};
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <vector>
+#include <future>
+#include "SyncAdapter.h"
+
+using namespace std;
+
+SyncAdapter::SyncAdapter(shared_ptr<AsyncIOLayer> io)
+    : m_io(io)
+{
+}
+
+void SyncAdapter::Load(vector<uint8_t> bytes, uint16_t address)
+{
+    m_io->LoadAsync(move(bytes), address).get();
+}
+
+void SyncAdapter::Output(uint8_t value, uint16_t address)
+{
+    m_io->OutputAsync(value, address).get();
+}
+
+uint8_t SyncAdapter::Input(uint16_t address)
+{
+    return m_io->InputAsync(address).get();
+}
\ No newline at end of file
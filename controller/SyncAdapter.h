@@ -0,0 +1,19 @@
+#pragma once
+
+#include "IOLayer.h"
+#include "AsyncIOLayer.h"
+
+// Presents an AsyncIOLayer as a synchronous IOLayer, for code that only knows IOLayer (e.g.
+// CodeBuffer::Flush). Every call waits for its request to complete.
+class SyncAdapter : public IOLayer
+{
+public:
+    SyncAdapter(std::shared_ptr<AsyncIOLayer> io);
+
+    virtual void Load(std::vector<uint8_t> bytes, uint16_t address = 0);
+    virtual void Output(uint8_t value, uint16_t address);
+    virtual uint8_t Input(uint16_t address);
+
+private:
+    std::shared_ptr<AsyncIOLayer> m_io;
+};
\ No newline at end of file
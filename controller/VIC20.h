@@ -0,0 +1,20 @@
+#pragma once
+
+// VIC-20 memory map.
+
+const uint16_t BLK1 = 0x2000;   // to 0x3fff
+const uint16_t BLK2 = 0x4000;   // to 0x5fff
+const uint16_t BLK3 = 0x6000;   // to 0x7fff
+const uint16_t BLK5 = 0xa000;   // to 0xbfff
+const uint16_t BLK_Size = 0x2000;
+const uint16_t RAM1 = 0x0400;   // to 0x07ff
+const uint16_t RAM2 = 0x0800;   // to 0x0bff
+const uint16_t RAM3 = 0x0c00;   // to 0x0fff
+
+const uint16_t VIC_ColorRegister = 0x900F;  // bits 0-2: border color
+                                            // bit    3: inverted/normal
+                                            // bit  4-7: background color
+
+const uint16_t VIC_ScreenRAM = 0x1e00;      // unexpanded or 3K-expanded machine
+const uint16_t VIC_ColorRAM = 0x9600;
+const uint16_t VIC_ScreenSize = 22 * 23;
\ No newline at end of file
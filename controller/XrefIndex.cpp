@@ -0,0 +1,296 @@
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include "XrefIndex.h"
+#include "VIC20.h"
+
+using namespace std;
+
+using Instruction = Asm6502::Instruction;
+using Mode = Asm6502::Mode;
+
+static bool IsTerminator(const Asm6502::Disassembly& instr)
+{
+    switch (instr.Instruction)
+    {
+    case Instruction::JMP:
+    case Instruction::RTS:
+    case Instruction::RTI:
+    case Instruction::BRK:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static XrefIndex::RefKind DataRefKind(Instruction instr)
+{
+    if (instr == Instruction::STA || instr == Instruction::STX || instr == Instruction::STY)
+        return XrefIndex::RefKind::Write;
+    if (Asm6502::IsReadModifyWrite(instr))
+        return XrefIndex::RefKind::ReadWrite;
+    return XrefIndex::RefKind::Read;
+}
+
+static bool RefLess(const XrefIndex::Ref& a, const XrefIndex::Ref& b)
+{
+    if (a.Target != b.Target)
+        return a.Target < b.Target;
+    if (a.Kind != b.Kind)
+        return a.Kind < b.Kind;
+    return a.From < b.From;
+}
+
+static bool CallerLess(const XrefIndex::Call& a, const XrefIndex::Call& b)
+{
+    if (a.Caller != b.Caller)
+        return a.Caller < b.Caller;
+    if (a.Callee != b.Callee)
+        return a.Callee < b.Callee;
+    return a.From < b.From;
+}
+
+static bool CalleeLess(const XrefIndex::Call& a, const XrefIndex::Call& b)
+{
+    if (a.Callee != b.Callee)
+        return a.Callee < b.Callee;
+    if (a.Caller != b.Caller)
+        return a.Caller < b.Caller;
+    return a.From < b.From;
+}
+
+XrefIndex::XrefIndex(const vector<Asm6502::Disassembly>& code, const vector<uint16_t>& entries)
+{
+    m_refs.reserve(code.size());
+    for (const auto& instr : code)
+    {
+        Ref ref;
+        ref.From = instr.Address;
+        switch (instr.Mode)
+        {
+        case Mode::Rel:
+            ref.Target = static_cast<uint16_t>(instr.Address + 2 + static_cast<int8_t>(instr.Arg.u8));
+            ref.Kind = RefKind::Branch;
+            break;
+
+        case Mode::Abs:
+            ref.Target = instr.Arg.u16;
+            if (instr.Instruction == Instruction::JMP)
+                ref.Kind = RefKind::Jump;
+            else if (instr.Instruction == Instruction::JSR)
+                ref.Kind = RefKind::Call;
+            else
+                ref.Kind = DataRefKind(instr.Instruction);
+            break;
+
+        case Mode::AbsX:
+        case Mode::AbsY:
+            ref.Target = instr.Arg.u16;
+            ref.Kind = DataRefKind(instr.Instruction);
+            break;
+
+        case Mode::ZP:
+        case Mode::ZPX:
+        case Mode::ZPY:
+            ref.Target = instr.Arg.u8;
+            ref.Kind = DataRefKind(instr.Instruction);
+            break;
+
+        case Mode::Ind:
+            // The pointer itself is read; where it points isn't known until run time.
+            ref.Target = instr.Arg.u16;
+            ref.Kind = RefKind::Read;
+            break;
+
+        case Mode::IndX:
+        case Mode::IndY:
+            ref.Target = instr.Arg.u8;
+            ref.Kind = RefKind::Read;
+            break;
+
+        default:
+            continue;
+        }
+        m_refs.push_back(ref);
+    }
+    sort(m_refs.begin(), m_refs.end(), RefLess);
+
+    // A block starts at every entry point and control flow target, and wherever straight-line
+    // flow is broken: after a branch or terminator, or at a gap in the code.
+    vector<bool> leader(1 << 16);
+    for (uint16_t entry : entries)
+        leader[entry] = true;
+    for (const auto& ref : m_refs)
+    {
+        if (ref.Kind == RefKind::Branch || ref.Kind == RefKind::Jump || ref.Kind == RefKind::Call)
+            leader[ref.Target] = true;
+    }
+
+    vector<size_t> firstInstr;
+    vector<size_t> lastInstr;
+    uint32_t prevEnd = 0;
+    for (size_t i = 0, n = code.size(); i < n; i++)
+    {
+        const auto& instr = code[i];
+        bool starts = (i == 0)
+            || leader[instr.Address]
+            || prevEnd != instr.Address
+            || code[i - 1].Mode == Mode::Rel
+            || IsTerminator(code[i - 1]);
+        if (starts)
+        {
+            if (i > 0)
+                lastInstr.push_back(i - 1);
+            firstInstr.push_back(i);
+            Block block = { instr.Address, instr.Address, 0 };
+            m_blocks.push_back(block);
+        }
+
+        prevEnd = instr.Address + Asm6502::Length(instr.Mode);
+        m_blocks.back().Last = instr.Address;
+        m_blocks.back().End = prevEnd;
+    }
+    if (!code.empty())
+        lastInstr.push_back(code.size() - 1);
+
+    m_functions = entries;
+    for (const auto& ref : m_refs)
+    {
+        if (ref.Kind == RefKind::Call)
+            m_functions.push_back(ref.Target);
+    }
+    sort(m_functions.begin(), m_functions.end());
+    m_functions.erase(unique(m_functions.begin(), m_functions.end()), m_functions.end());
+
+    // Walk each function's blocks to find the calls it makes. A jump to another function's entry
+    // point is a tail call, and ends the walk like a return would.
+    vector<size_t> visitedBy(m_blocks.size(), numeric_limits<size_t>::max());
+    vector<size_t> pending;
+    for (size_t f = 0, nf = m_functions.size(); f < nf; f++)
+    {
+        uint16_t function = m_functions[f];
+        const Block* entry = BlockAt(function);
+        if (entry == nullptr || entry->Start != function)
+            continue;
+        pending.push_back(entry - m_blocks.data());
+
+        while (!pending.empty())
+        {
+            size_t b = pending.back();
+            pending.pop_back();
+            if (visitedBy[b] == f)
+                continue;
+            visitedBy[b] = f;
+
+            for (size_t i = firstInstr[b]; i <= lastInstr[b]; i++)
+            {
+                if (code[i].Instruction == Instruction::JSR)
+                {
+                    Call call = { function, code[i].Arg.u16, code[i].Address };
+                    m_calls.push_back(call);
+                }
+            }
+
+            const auto& last = code[lastInstr[b]];
+            uint32_t successors[2];
+            size_t nSuccessors = 0;
+            if (last.Mode == Mode::Rel)
+            {
+                successors[nSuccessors++] = m_blocks[b].End;
+                successors[nSuccessors++] = static_cast<uint16_t>(m_blocks[b].End + static_cast<int8_t>(last.Arg.u8));
+            }
+            else if (last.Instruction == Instruction::JMP && last.Mode == Mode::Abs)
+            {
+                uint16_t target = last.Arg.u16;
+                if (target != function && binary_search(m_functions.begin(), m_functions.end(), target))
+                {
+                    Call call = { function, target, last.Address };
+                    m_calls.push_back(call);
+                }
+                else
+                {
+                    successors[nSuccessors++] = target;
+                }
+            }
+            else if (!IsTerminator(last))
+            {
+                successors[nSuccessors++] = m_blocks[b].End;
+            }
+
+            for (size_t s = 0; s < nSuccessors; s++)
+            {
+                if (successors[s] > 0xffff)
+                    continue;
+                const Block* next = BlockAt(static_cast<uint16_t>(successors[s]));
+                if (next != nullptr && next->Start == successors[s])
+                    pending.push_back(next - m_blocks.data());
+            }
+        }
+    }
+
+    sort(m_calls.begin(), m_calls.end(), CallerLess);
+    m_callers = m_calls;
+    sort(m_callers.begin(), m_callers.end(), CalleeLess);
+}
+
+vector<uint16_t> XrefIndex::EntryVectors(IOLayer& io)
+{
+    vector<uint16_t> entries;
+
+    // An autostart cartridge has its cold and warm start vectors at BLK5, followed by "A0CBM".
+    static const uint8_t signature[] = { 0x41, 0x30, 0xc3, 0xc2, 0xcd };
+    bool autostart = true;
+    for (size_t i = 0; i < _countof(signature); i++)
+    {
+        if (io.Input(static_cast<uint16_t>(BLK5 + 4 + i)) != signature[i])
+            autostart = false;
+    }
+    if (autostart)
+    {
+        entries.push_back(io.Input(BLK5) | (io.Input(BLK5 + 1) << 8));
+        entries.push_back(io.Input(BLK5 + 2) | (io.Input(BLK5 + 3) << 8));
+    }
+
+    for (uint32_t v = 0xfffa; v < 0x10000; v += 2)
+    {
+        entries.push_back(io.Input(static_cast<uint16_t>(v)) | (io.Input(static_cast<uint16_t>(v + 1)) << 8));
+    }
+
+    return entries;
+}
+
+pair<XrefIndex::RefIterator, XrefIndex::RefIterator> XrefIndex::Referrers(uint16_t target) const
+{
+    return equal_range(m_refs.begin(), m_refs.end(), Ref{ target, RefKind::Jump, 0 },
+        [](const Ref& a, const Ref& b) { return a.Target < b.Target; });
+}
+
+pair<XrefIndex::RefIterator, XrefIndex::RefIterator> XrefIndex::Referrers(uint16_t target, RefKind kind) const
+{
+    return equal_range(m_refs.begin(), m_refs.end(), Ref{ target, kind, 0 },
+        [](const Ref& a, const Ref& b) { return a.Target < b.Target || (a.Target == b.Target && a.Kind < b.Kind); });
+}
+
+const XrefIndex::Block* XrefIndex::BlockAt(uint16_t address) const
+{
+    auto it = upper_bound(m_blocks.begin(), m_blocks.end(), address,
+        [](uint16_t address, const Block& block) { return address < block.Start; });
+    if (it == m_blocks.begin())
+        return nullptr;
+    --it;
+    return (address < it->End) ? &*it : nullptr;
+}
+
+pair<XrefIndex::CallIterator, XrefIndex::CallIterator> XrefIndex::Callees(uint16_t function) const
+{
+    return equal_range(m_calls.begin(), m_calls.end(), Call{ function, 0, 0 },
+        [](const Call& a, const Call& b) { return a.Caller < b.Caller; });
+}
+
+pair<XrefIndex::CallIterator, XrefIndex::CallIterator> XrefIndex::Callers(uint16_t function) const
+{
+    return equal_range(m_callers.begin(), m_callers.end(), Call{ 0, function, 0 },
+        [](const Call& a, const Call& b) { return a.Callee < b.Callee; });
+}
\ No newline at end of file
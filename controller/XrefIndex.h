@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Asm6502.h"
+
+// Cross-reference and control-flow index over disassembled code, normally the output of
+// Asm6502::DisassembleReachable.
+//
+// Everything is built in one pass and kept in flat sorted arrays, so queries like "who writes
+// $900F" or "what calls this routine" are a binary search.
+class XrefIndex
+{
+public:
+    enum class RefKind : uint8_t
+    {
+        Jump,
+        Call,
+        Branch,
+        Read,
+        Write,
+        ReadWrite,  // read-modify-write instructions like INC and ASL
+    };
+
+    struct Ref
+    {
+        uint16_t Target;
+        RefKind Kind;
+        uint16_t From;
+    };
+
+    struct Block
+    {
+        uint16_t Start;
+        uint16_t Last;      // address of the last instruction
+        uint32_t End;       // one past the last byte
+    };
+
+    struct Call
+    {
+        uint16_t Caller;    // entry point of the calling function
+        uint16_t Callee;
+        uint16_t From;      // address of the JSR (or tail JMP)
+    };
+
+    typedef std::vector<Ref>::const_iterator RefIterator;
+    typedef std::vector<Call>::const_iterator CallIterator;
+
+    XrefIndex(const std::vector<Asm6502::Disassembly>& code, const std::vector<uint16_t>& entries);
+
+    // Entry points named by a VIC-20 autostart cartridge header at BLK5 (if present), followed by
+    // the 6502 NMI, RESET and IRQ vectors.
+    static std::vector<uint16_t> EntryVectors(IOLayer& io);
+
+    // References to an address, sorted by kind and then by referring address.
+    std::pair<RefIterator, RefIterator> Referrers(uint16_t target) const;
+    std::pair<RefIterator, RefIterator> Referrers(uint16_t target, RefKind kind) const;
+
+    // The basic block containing an address, or nullptr if it isn't known code.
+    const Block* BlockAt(uint16_t address) const;
+    const std::vector<Block>& Blocks() const { return m_blocks; }
+
+    // Function entry points: the given entries plus every subroutine call target.
+    const std::vector<uint16_t>& Functions() const { return m_functions; }
+
+    std::pair<CallIterator, CallIterator> Callees(uint16_t function) const;
+    std::pair<CallIterator, CallIterator> Callers(uint16_t function) const;
+
+private:
+    std::vector<Ref> m_refs;            // sorted by Target, Kind, From
+    std::vector<Block> m_blocks;        // sorted by Start
+    std::vector<uint16_t> m_functions;  // sorted
+    std::vector<Call> m_calls;          // sorted by Caller, Callee, From
+    std::vector<Call> m_callers;        // sorted by Callee, Caller, From
+};
\ No newline at end of file
@@ -3,24 +3,27 @@
 #include <exception>
 #include <memory>
 #include <vector>
+#include <unordered_map>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cwchar>
 #include "StdioLayer.h"
+#include "CodeBuffer.h"
 #include "Asm6502.h"
+#include "Linker.h"
+#include "VIC20.h"
+#include "XrefIndex.h"
+#include "SignatureSearch.h"
+#include "AsyncAdapter.h"
+#include "ImageFile.h"
 
 using namespace std;
 
-const uint16_t BLK1 = 0x2000;   // to 0x3fff
-const uint16_t BLK2 = 0x4000;   // to 0x5fff
-const uint16_t BLK3 = 0x6000;   // to 0x7fff
-const uint16_t BLK5 = 0xa000;   // to 0xbfff
-const uint16_t RAM1 = 0x0400;   // to 0x07ff
-const uint16_t RAM2 = 0x0800;   // to 0x0bff
-const uint16_t RAM3 = 0x0c00;   // to 0x0fff
-
-const uint16_t VIC_ColorRegister = 0x900F;  // bits 0-2: border color
-                                            // bit    3: inverted/normal
-                                            // bit  4-7: background color
-
 using Implied = Asm6502::InstrImplied;
 using Immed = Asm6502::InstrImmed;
 using A = Asm6502::InstrA;
@@ -35,8 +38,99 @@ using Ind = Asm6502::InstrInd;
 using IndX = Asm6502::InstrIndX;
 using IndY = Asm6502::InstrIndY;
 
+// VICmaster scan [-b "hex bytes"] [-i "instruction"] files...
+static int Scan(int argc, wchar_t* argv[])
+{
+    SignatureSearch search;
+    vector<wstring> patterns;
+    vector<wstring> files;
+    for (int i = 2; i < argc; i++)
+    {
+        wstring arg = argv[i];
+        if ((arg == L"-b" || arg == L"-i") && i + 1 < argc)
+        {
+            wstring text = argv[++i];
+            if (any_of(text.begin(), text.end(), [](wchar_t c) { return (c & ~0x7f) != 0; }))
+            {
+                wcerr << L"bad pattern \"" << text << L"\": patterns must be ASCII" << endl;
+                return 1;
+            }
+            string narrow(text.begin(), text.end());
+            try
+            {
+                if (arg == L"-b")
+                    search.AddBytePattern(narrow);
+                else
+                    search.AddInstructionPattern(narrow);
+            }
+            catch (exception* e)
+            {
+                wcerr << L"bad pattern \"" << text << L"\": " << e->what() << endl;
+                delete e;
+                return 1;
+            }
+            patterns.push_back(text);
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+
+    auto result = search.Search(files);
+    for (const auto& match : result.Matches)
+        wcout << files[match.File] << L" +" << hex << match.Offset << L": " << patterns[match.Pattern] << endl;
+    for (size_t f : result.Unreadable)
+        wcerr << L"unable to read " << files[f] << endl;
+    return result.Unreadable.empty() ? 0 : 1;
+}
+
+// VICmaster convert <input> <output> [cartridge block]
+// Files are .prg, .hex (Intel HEX) or .bin (raw cartridge at the block, $a000 by default).
+static int Convert(int argc, wchar_t* argv[])
+{
+    if (argc < 4)
+    {
+        wcerr << L"usage: VICmaster convert <input> <output> [cartridge block]" << endl;
+        return 1;
+    }
+    uint16_t block = BLK5;
+    if (argc > 4)
+    {
+        const wchar_t* text = (argv[4][0] == L'$') ? argv[4] + 1 : argv[4];
+        wchar_t* end;
+        unsigned long value = wcstoul(text, &end, 16);
+        if (end == text || *end != L'\0'
+            || (value != BLK1 && value != BLK2 && value != BLK3 && value != BLK5))
+        {
+            wcerr << L"cartridge block must be 2000, 4000, 6000 or a000" << endl;
+            return 1;
+        }
+        block = static_cast<uint16_t>(value);
+    }
+
+    try
+    {
+        StdioLayer memory(1 << 16);
+        auto ranges = ImageFile::Read(argv[2], memory, block);
+        ImageFile::Write(argv[3], memory, ranges, block);
+    }
+    catch (exception* e)
+    {
+        wcerr << L"convert failed: " << e->what() << endl;
+        delete e;
+        return 1;
+    }
+    return 0;
+}
+
 int wmain(int argc, wchar_t* argv[])
 {
+    if (argc > 1 && wstring(argv[1]) == L"scan")
+        return Scan(argc, argv);
+    if (argc > 1 && wstring(argv[1]) == L"convert")
+        return Convert(argc, argv);
+
     auto io = std::make_shared<StdioLayer>(1<<16);
     Asm6502 cpu(io);
 
@@ -56,10 +150,48 @@ int wmain(int argc, wchar_t* argv[])
     Asm6502::PrintDisassembly(disasem);
     cout << endl;
 
-    // Output a basic test program.
-    cpu.CurrentAddress = BLK5;              // Start of cartridge ROM program
-    cpu.Emit(Abs::INC, VIC_ColorRegister);  // Increment the VIC's draw color
-    cpu.Emit(Abs::JMP, BLK5);               // jump back
+    // Assemble a basic test program into a buffer, then send it to the target in one go.
+    auto code = std::make_shared<CodeBuffer>();
+    Asm6502 cartridge(code);
+    cartridge.CurrentAddress = code->AddSection("code", BLK5, BLK5 + 0x2000);  // Start of cartridge ROM program
+    cartridge.Emit(Abs::INC, VIC_ColorRegister);    // Increment the VIC's draw color
+    cartridge.Emit(Abs::JMP, BLK5);                 // jump back
+    code->Flush(*io);
+
+    // Link a cartridge from two separately assembled modules.
+    auto lib = std::make_shared<ObjectModule>();
+    Asm6502 libAsm(lib);
+    libAsm.Label("flash");
+    libAsm.Emit(Abs::INC, VIC_ColorRegister);
+    libAsm.Emit(Implied::RTS);
+
+    auto prog = std::make_shared<ObjectModule>();
+    Asm6502 progAsm(prog);
+    progAsm.Label("start");
+    progAsm.Emit(Abs::JSR, "flash");
+    progAsm.Emit(Abs::JMP, "start");
+
+    Linker linker;
+    linker.Place("code", "BLK3");
+    linker.AddModule("prog", prog);
+    linker.AddModule("lib", lib);
+    linker.Link();
+    linker.Flush(*io);
+
+    // Find everything reachable from the two programs that touches the VIC's color register.
+    vector<uint16_t> entries = { BLK5, linker.SymbolAddress("start") };
+    XrefIndex xrefs(cpu.DisassembleReachable(entries), entries);
+    auto refs = xrefs.Referrers(VIC_ColorRegister);
+    for (auto it = refs.first; it != refs.second; ++it)
+        cout << hex << setw(4) << setfill('0') << it->From << " touches $" << VIC_ColorRegister << endl;
+    cout << endl;
+
+    // The same walk through the asynchronous interface, with the reads for every page it reaches
+    // in flight together instead of one byte at a time.
+    auto async = std::make_shared<AsyncAdapter>(io);
+    Asm6502 remote(async);
+    cout << dec << remote.DisassembleReachable(entries).size() << " instructions reachable" << endl;
+    cout << endl;
 
     io->Print();
 